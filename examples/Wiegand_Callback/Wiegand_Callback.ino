@@ -0,0 +1,46 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Callback.ino
+// Purpose    : Example code for Wiegand library callbacks (build with -D WIEGAND_TIMER=1, needs TimerOne on AVR)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include "Wiegand.h"
+#include "SimpleUtils.h"
+
+#if !WIEGAND_TIMER
+#error "build with -D WIEGAND_TIMER=1 (e.g. build_flags in platformio.ini)"
+#endif
+
+Wiegand wg( 2, 3);    // D0 = pin 2 & D1 = pin 3
+
+// called from timer context (keep short)
+void tagReceived( uint64_t code, byte bits)
+{
+  LABEL( F( "# Wiegand HEX = "), hex(( unsigned long) code, 8));
+  LABEL( F( " W"), bits) LF;
+}
+
+// called from timer context (keep short)
+void pinEntered( unsigned long code)
+{
+  LABEL( F( "# Wiegand PIN = "), dec( code, 8)) LF;
+}
+
+void setup() {
+  BEGIN( 9600);
+
+  PRINT( F( "# =========================")) LF;
+  PRINT( F( "# - RFID WG callback test -")) LF;
+  PRINT( F( "# =========================")) LF;
+
+  wg.onTag( tagReceived);
+  wg.onPin( pinEntered);
+  wg.begin();
+}
+
+void loop() {
+  delay( 1000);         // blocking code does not delay reads
+}
@@ -0,0 +1,37 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Capture.ino
+// Purpose    : Example code for raw edge capture (build with -D WIEGAND_CAPTURE=64, trace on Serial, replay with wgreplay)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include "Wiegand.h"
+#include "SimpleUtils.h"
+
+#if !WIEGAND_CAPTURE
+#error "build with -D WIEGAND_CAPTURE=64 (e.g. build_flags in platformio.ini)"
+#endif
+
+Wiegand            wg( 2, 3);                               // D0 = pin 2 & D1 = pin 3
+WiegandTraceWriter trace( Serial);                          // one line per frame
+
+void setup() {
+  BEGIN( 115200);
+
+  PRINT( F( "# ========================")) LF;
+  PRINT( F( "# - RFID WG edge capture -")) LF;
+  PRINT( F( "# ========================")) LF;
+
+  wg.begin();
+}
+
+void loop() {
+  wg.dumpTrace( trace);                                     // edges since last call (save the output, then: wgreplay trace.txt)
+
+  if ( wg.available()) {
+    trace.end();                                            // frame line complete
+    PRINT( F( "# code = ")); PRINT( wg.getCode()) LF;       // comment line in trace
+  }
+}
@@ -47,12 +47,12 @@ void loop() {
   if ( wg.available()) {                                    // if new tag / key value available
     if ( wg.getType() == WTAG) {                            // if tag value (W26 / W32)
       LABEL( F( "> Wiegand Tag Code = "), hex( wg.getTagCode(), 8));
-      PRINT( F( " (")); PRINT( WGTypeLabel[wg.getType()]); PRINT( F( ")")) LF;
+      PRINT( F( " (")); PRINT( wg.getTypeLabel()); PRINT( F( ")")) LF;
     }
 
     if ( wg.getType() == WKEY) {                            // if key value (W4 / W8)
       LABEL( F( "> Wiegand Key Code = "), dec( wg.getKeyCode(), 6));
-      PRINT( F( " (")); PRINT( WGTypeLabel[wg.getType()]); PRINT( F( ")")) LF;
+      PRINT( F( " (")); PRINT( wg.getTypeLabel()); PRINT( F( ")")) LF;
     }
 
     if ( mode == NORMAL) {                                  // if normal model
@@ -138,7 +138,7 @@ void printMenu() {
 // print all tag data in EEPROM database to the serial monitor, active tag in slot = idx
 void printTags()
 {
-  for ( int i = 0; i < MAX_TAGS; i++) {
+  for ( int i = 0; i < wg.getCapacity(); i++) {
     printTag( i);
   }
 }
@@ -146,7 +146,7 @@ void printTags()
 // print tag data in EEPROM database to the serial monitor for a specific slot = idx
 void printTag( int slot)
 {
-  if (( slot < 0) || ( slot > MAX_TAGS - 1)) {
+  if (( slot < 0) || ( slot > wg.getCapacity() - 1)) {
     PRINT( F( "> error: index out of range")) LF;
   } else {
     LABEL( F( "# entry "), slot); PRINT( F( " > "));
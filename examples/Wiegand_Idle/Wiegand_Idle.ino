@@ -0,0 +1,36 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Idle.ino
+// Purpose    : Example code for a reader asleep between frames (woken by the edges on D0 / D1)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include "Wiegand.h"
+#include "SimpleUtils.h"
+
+Wiegand wg( 2, 3);                                          // D0 = pin 2 & D1 = pin 3
+
+void setup() {
+  BEGIN( 9600);
+
+  PRINT( F( "# ========================")) LF;
+  PRINT( F( "# - RFID WG idle reader  -")) LF;
+  PRINT( F( "# ========================")) LF;
+
+  wg.begin();
+}
+
+void loop() {
+  Serial.flush();                                           // Serial sends by interrupt (would wake the MCU)
+
+  if ( !Wiegand::idle( 60000UL)) {                          // asleep until a frame is complete (at most 1 minute)
+    PRINT( F( "# no tag for 1 minute")) LF;
+  }
+
+  if ( wg.available()) {
+    PRINT( F( "> ")); PRINT( wg.getTypeLabel());
+    PRINT( F( " = ")); PRINT( wg.getCode()) LF;
+  }
+}
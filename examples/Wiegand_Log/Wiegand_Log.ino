@@ -0,0 +1,52 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Log.ino
+// Purpose    : Example code for the access event log (tag table + log in EEPROM regions, send 'l' to list the log)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include <Wiegand_EEPROM.h>
+#include "SimpleUtils.h"
+
+WiegandStorage_EEPROM tagRegion( 0,   512);                 // tag table = EEPROM bytes 0 .. 511
+WiegandStorage_EEPROM logRegion( 512, 512);                 // log = EEPROM bytes 512 .. 1023 (32 records)
+
+Wiegand_EEPROM wg( 2, 3, tagRegion);                        // D0 = pin 2 & D1 = pin 3
+WiegandLog     wgLog( logRegion);
+
+void setup() {
+  BEGIN( 9600);
+
+  PRINT( F( "# ========================")) LF;
+  PRINT( F( "# - RFID WG access log   -")) LF;
+  PRINT( F( "# ========================")) LF;
+
+  wg.begin();
+  wgLog.begin();
+  wgLog.setTime( 1500000000UL);                             // seconds (from an RTC / NTP in a real system)
+  wg.setLog( wgLog);                                        // one record per code available
+
+  PRINT( F( "# log records = ")); PRINT( wgLog.getCount()); PRINT( F( " / ")); PRINT( wgLog.getCapacity()) LF;
+}
+
+void loop() {
+  if ( wg.available()) {
+    PRINT( F( "> Tag = ")); PRINT( wg.getCode());
+    PRINT(( wg.getSlot() >= 0) ? F( " (known)") : F( " (unknown)")) LF;
+  }
+
+  wgLog.handle();                                           // write staged records (batch, not on the read path)
+
+  if ( Serial.available() && ( Serial.read() == 'l')) {
+    WiegandLogRecord record;
+
+    for ( uint16_t cursor = wgLog.first(); wgLog.read( cursor, record); ) {
+      PRINT( record.sequence); PRINT( F( " ")); PRINT( record.time);
+      PRINT( F( " tag = ")); PRINT( record.tag);
+      PRINT( F( " slot = ")); PRINT( record.slot);
+      PRINT( F( " access = ")); PRINT( record.access) LF;
+    }
+  }
+}
@@ -0,0 +1,56 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Relay.ino
+// Purpose    : Example code for passing tags on to an access controller (reader on pins 2 / 3, controller on pins 5 / 6,
+//              build with -D WIEGAND_OUT=1)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandOut.h>
+#include "SimpleUtils.h"
+
+#if !WIEGAND_OUT
+#error "build with -D WIEGAND_OUT=1 (e.g. build_flags in platformio.ini)"
+#endif
+
+Wiegand    wg( 2, 3);                                       // D0 = pin 2 & D1 = pin 3 (reader)
+WiegandOut out( 5, 6);                                      // D0 = pin 5 & D1 = pin 6 (controller)
+
+void setup() {
+  BEGIN( 9600);
+
+  PRINT( F( "# ===================")) LF;
+  PRINT( F( "# - RFID WG relay   -")) LF;
+  PRINT( F( "# ===================")) LF;
+
+  wg.begin();
+
+  if ( !out.begin()) {
+    PRINT( F( "# no timer for WiegandOut")) LF;
+  }
+}
+
+void loop() {
+  if ( wg.available()) {
+    if ( wg.getType() == WTAG) {
+      PRINT( F( "> Tag = ")); PRINT( wg.getCode());
+
+      if ( out.relay( wg)) {                                // frame as received, sent in the background
+        PRINT( F( " (sent)")) LF;
+      } else {
+        PRINT( F( " (queue full)")) LF;
+      }
+    } else {
+      PRINT( F( "> PIN = ")); PRINT( wg.getKeyCode());
+
+      if ( out.sendPin( wg.getKeyCode())) {                 // keys + '#' (4 bit, all or nothing)
+        PRINT( F( " (sent)")) LF;
+      } else {
+        PRINT( F( " (queue full)")) LF;
+      }
+    }
+  }
+}
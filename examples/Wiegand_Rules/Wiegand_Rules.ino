@@ -0,0 +1,61 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Rules.ino
+// Purpose    : Example code for access rules (tag / tag + PIN, door groups, weekly schedules, see WiegandRules.h)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include <Wiegand_EEPROM.h>
+#include "SimpleUtils.h"
+
+#define DOOR_RELAY 7                                        // door opener
+
+Wiegand_EEPROM wg( 2, 3);                                   // D0 = pin 2 & D1 = pin 3
+WiegandRules   rules;
+
+void setup() {
+  BEGIN( 9600);
+
+  PRINT( F( "# ========================")) LF;
+  PRINT( F( "# - RFID WG access rules -")) LF;
+  PRINT( F( "# ========================")) LF;
+
+  pinMode( DOOR_RELAY, OUTPUT);
+
+  rules.setDoors( 1, 0x01);                                 // group 1 = staff: this door, weekdays 07:00 .. 19:00
+  rules.allow( 1, WG_WEEKDAYS, 7 * 60, 19 * 60);
+  rules.setDoors( 2, 0x01);                                 // group 2 = cleaning: this door, every evening 18:00 .. 22:00
+  rules.allow( 2, WG_ALLDAYS, 18 * 60, 22 * 60);
+  rules.setTime( 0, 8, 30);                                 // Monday 08:30 (from an RTC / NTP in a real system, set again daily)
+
+  wg.begin();
+  wg.setRules( rules, 0);                                   // this reader = door 0
+
+  if ( wg.getCapacity() && !wg.searchTag( 0x00123456)) {
+    wg.createTag( 0x00123456, 0,    1);                     // staff badge, tag only
+    wg.createTag( 0x00654321, 1234, 2);                     // cleaning badge, tag + PIN 1234
+  }
+}
+
+void loop() {
+  if ( wg.available()) {
+    switch ( wg.getAccess()) {                              // decision made by the library
+      case WG_GRANTED:
+        PRINT( F( "> Access granted")) LF;
+        digitalWrite( DOOR_RELAY, HIGH);
+        delay( 3000);
+        digitalWrite( DOOR_RELAY, LOW);
+        break;
+      case WG_ENTER_PIN:
+        PRINT( F( "> Enter PIN + #")) LF;
+        break;
+      case WG_OUT_OF_TIME:
+        PRINT( F( "> Access denied (time)")) LF;
+        break;
+      default:
+        PRINT( F( "> Access denied")) LF;
+    }
+  }
+}
@@ -0,0 +1,28 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : Wiegand_Sync.ino
+// Purpose    : Example code for WiegandSync (tag database import / export with extras/tools, e.g. wgsync import /dev/ttyUSB0 tags.csv)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <Arduino.h>
+#include <Wiegand_EEPROM.h>
+#include <WiegandSync.h>
+
+Wiegand_EEPROM wg( 2, 3);                                   // D0 = pin 2 & D1 = pin 3
+WiegandSync    wgSync( wg, Serial);                         // Serial = binary frames only (no debug prints)
+
+void setup() {
+  Serial.begin( 115200);
+
+  wg.begin();
+}
+
+void loop() {
+  wgSync.handle();                                          // import / export requests from the host
+
+  if ( wg.available() && wg.searchTag()) {
+    digitalWrite( LED_BUILTIN, HIGH);                       // known tag
+  }
+}
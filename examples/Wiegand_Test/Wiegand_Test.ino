@@ -39,6 +39,6 @@ void loop() {
       LABEL( F( "# Wiegand DEC = "), dec( wg.getKeyCode(), 8));
     }
 
-    LABEL( F( " "), WGTypeLabel[ wg.getType()]) LF;
+    LABEL( F( " "), wg.getTypeLabel()) LF;
   }
 }
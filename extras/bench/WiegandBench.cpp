@@ -0,0 +1,878 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host)
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandBench.cpp
+// Purpose    : Benchmark of the decoder (ISR, frames/sec, read latency) and the tag database (lookup / edit)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// usage: bench [frames] (default 20000), exits with 1 when a frame / tag is not handled correctly
+// host timings (ns / us) compare builds on the same machine; simulated timings (ms) follow the Wiegand protocol
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "Wiegand_EEPROM.h"
+#include "WiegandSync.h"
+#include "WiegandOut.h"
+
+#define PIN_D0         2                                    // reader lines (simulated)
+#define PIN_D1         3
+#define PIN_IDLE_D0    10                                   // lines without interrupt (baseline of pin toggling)
+#define PIN_IDLE_D1    11
+#define PIN_RULES_D0   4                                    // second reader (access rules)
+#define PIN_RULES_D1   5
+#define PIN_OUT_D0     6                                    // transmitter lines (wired to PIN_D0 / PIN_D1)
+#define PIN_OUT_D1     7
+
+#define PULSE_WIDTH    50                                   // us (Wiegand pulse)
+#define PULSE_INTERVAL 2000                                 // us (Wiegand bit interval)
+#define POLL_INTERVAL  1000                                 // us between calls of available() (loop time)
+#define SYNC_BAUD      115200                               // serial link of import / export (10 bits per byte)
+
+#if WIEGAND_EEPROM_LAYOUT == WG_LAYOUT_PACKED
+#define TAG_STEP       2999UL                               // distance of stored tags (packed = tags below 2^24)
+#else
+#define TAG_STEP       7919UL
+#endif
+
+static int errors = 0;
+
+#if WIEGAND_TIMER
+static unsigned long tagTime = 0;                           // time of last tag callback (us)
+
+static void tagReceived( uint64_t, byte)
+{
+  tagTime = micros();
+}
+#endif
+
+// host time (ns)
+static unsigned long long now()
+{
+  return std::chrono::duration_cast< std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// W26 frame (HID H10301) for facility / card
+static uint64_t encodeW26( unsigned long facility, unsigned long card)
+{
+  unsigned long data  = (( facility & 0xFF) << 16) | ( card & 0xFFFF);
+  uint64_t      frame = ( uint64_t) data << 1;
+
+  if (  __builtin_popcountl( data >> 12)    & 0x01) frame |= 1ULL << 25;
+  if ( !( __builtin_popcountl( data & 0xFFF) & 0x01)) frame |= 1ULL;
+
+  return frame;
+}
+
+// send frame on lines D0 / D1 (first bit = hi bit)
+static void send( uint64_t frame, byte bits, int pinD0, int pinD1, unsigned long interval = PULSE_INTERVAL)
+{
+  for ( int i = bits - 1; i >= 0; i--) {
+    WiegandNative::pulse(( frame >> i) & 1 ? pinD1 : pinD0, PULSE_WIDTH);
+    WiegandNative::advance( interval - PULSE_WIDTH);
+  }
+}
+
+// per edge ISR cost, decode cost, frames/sec and read latency
+static void benchDecoder( Wiegand& wg, long frames)
+{
+  unsigned long long isrTime  = 0;                          // host time sending frames (ISR attached)
+  unsigned long long idleTime = 0;                          // host time sending frames (no ISR)
+  unsigned long long readTime = 0;                          // host time of loop (available() / timer interrupts)
+  unsigned long      latency  = 0;                          // simulated time last bit .. available()
+  unsigned long      maxLatency = 0;
+  unsigned long      edges    = WiegandNative::edges();
+
+  srand( 1);
+
+  for ( long i = 0; i < frames; i++) {
+    unsigned long facility = rand() & 0xFF;
+    unsigned long card     = rand() & 0xFFFF;
+    uint64_t      frame    = encodeW26( facility, card);
+
+    unsigned long long start = now();
+    send( frame, 26, PIN_IDLE_D0, PIN_IDLE_D1);             // same pin toggling, no interrupt
+    idleTime += now() - start;
+
+    start = now();
+    send( frame, 26, PIN_D0, PIN_D1);
+    isrTime += now() - start;
+
+    unsigned long last = micros() - PULSE_INTERVAL + PULSE_WIDTH;
+                                                            // time of last falling edge
+    bool          done = false;
+
+    start = now();
+
+    for ( int poll = 0; !done && ( poll < 1000); poll++) {  // loop until frame reported
+      done = wg.available();
+
+      if ( !done) WiegandNative::advance( POLL_INTERVAL);
+    }
+
+    readTime += now() - start;
+
+    #if WIEGAND_TIMER
+    unsigned long wait = tagTime - last;                    // callback time
+    #else
+    unsigned long wait = micros() - last;
+    #endif
+
+    latency += wait;
+    if ( wait > maxLatency) maxLatency = wait;
+
+    if ( !done || ( wg.getFacilityCode() != facility) || ( wg.getCardNumber() != card)) {
+      if ( errors++ < 5) printf( "error: frame %ld (facility %lu card %lu) not decoded\n", i, facility, card);
+    }
+  }
+
+  edges = WiegandNative::edges() - edges;
+
+  double isr   = edges ? ( double)( isrTime > idleTime ? isrTime - idleTime : 0) / edges : 0;
+  double frame = ( double)( isrTime - idleTime + readTime) / frames;
+
+  printf( "decoder   (W26, %ld frames, WIEGAND_TIMER = %d, WIEGAND_STATS = %d, WIEGAND_PCINT = %d)\n",
+          frames, WIEGAND_TIMER, WIEGAND_STATS, WIEGAND_PCINT);
+  printf( "  ISR per edge         %10.1f ns\n", isr);
+  printf( "  loop per frame       %10.1f ns  (available / timer until frame reported)\n", ( double) readTime / frames);
+  printf( "  decode per frame     %10.1f ns  (ISR + loop)\n", frame);
+  printf( "  frames/sec (host)    %10.0f\n", frame > 0 ? 1e9 / frame : 0);
+  printf( "  read latency         %10.2f ms  (max %.2f ms, last bit .. available)\n", latency / 1000.0 / frames, maxLatency / 1000.0);
+  printf( "  overflow             %10u\n", wg.getOverflowCount());
+}
+
+// read latency for readers with other bit intervals (frames 50 ms apart)
+static void benchIntervals( Wiegand& wg)
+{
+  unsigned long intervals[] = { 500, 1000, 2000, 5000, 10000 };
+
+  printf( "  interval (us)      ");
+  for ( int i = 0; i < 5; i++) printf( " %7lu", intervals[ i]);
+  printf( "\n  read latency (ms)  ");
+
+  for ( int i = 0; i < 5; i++) {
+    unsigned long latency = 0;
+
+    for ( int n = 0; n < 100; n++) {
+      unsigned long card = n * 613;
+
+      send( encodeW26( 1, card), 26, PIN_D0, PIN_D1, intervals[ i]);
+
+      unsigned long last = micros() - intervals[ i] + PULSE_WIDTH;
+      bool          done = false;
+
+      for ( int poll = 0; !done && ( poll < 1000); poll++) {
+        done = wg.available();
+
+        if ( !done) WiegandNative::advance( POLL_INTERVAL);
+      }
+
+      #if WIEGAND_TIMER
+      latency += tagTime - last;
+      #else
+      latency += micros() - last;
+      #endif
+
+      if ( !done || ( wg.getCardNumber() != card)) errors++;
+
+      WiegandNative::advance( 50000 - ( micros() - last));  // next frame
+    }
+
+    printf( " %7.2f", latency / 100000.0);
+  }
+
+  printf( "\n");
+}
+
+// loop for time (ms), returns number of codes reported by available()
+static int poll( Wiegand& wg, unsigned long ms)
+{
+  int codes = 0;
+
+  for ( unsigned long t = 0; t < ms * 1000; t += POLL_INTERVAL) {
+    if ( wg.available()) codes++;
+
+    WiegandNative::advance( POLL_INTERVAL);
+  }
+
+  return codes;
+}
+
+// repeated tag frames (card held at reader), bouncing keys and a PIN entry with a pause
+static void benchRepeat( Wiegand& wg)
+{
+  int          failed  = 0;
+  unsigned int repeats = wg.getRepeatCount();
+
+  wg.setRepeatWindow( 500, 100);                            // tag 500 ms, key 100 ms
+  wg.setKeyTimeout( 2000);
+
+  for ( int n = 0; n < 100; n++) {                          // card held for 4 frames, next card, first card again
+    unsigned long card = 1000 + n;
+
+    for ( int i = 0; i < 4; i++) {
+      send( encodeW26( 1, card), 26, PIN_D0, PIN_D1);
+      WiegandNative::advance( 100000);                      // reader repeats every 150 ms
+    }
+
+    if ( poll( wg, 10) != 1) failed++;                      // codes reported by frames so far (queue size 4)
+
+    send( encodeW26( 1, card + 1000), 26, PIN_D0, PIN_D1);  // other card within window = reported
+    WiegandNative::advance( 30000);
+    send( encodeW26( 1, card), 26, PIN_D0, PIN_D1);         // first card after other card = reported
+
+    if ( poll( wg, 100) != 2) failed++;
+
+    WiegandNative::advance( 600000);
+
+    send( encodeW26( 1, card), 26, PIN_D0, PIN_D1);         // window elapsed = reported
+
+    if ( poll( wg, 100) != 1) failed++;
+    WiegandNative::advance( 600000);
+  }
+
+  byte keys[] = { 1, 1, 2, 11 };                            // '1' bounces (40 ms), '2', '#'
+
+  for ( int i = 0; i < 4; i++) {
+    send( keys[ i], 4, PIN_D0, PIN_D1);
+    poll( wg, ( i == 0) ? 30 : 150);
+  }
+
+  if ( wg.getKeyCode() != 12) failed++;
+
+  send( 3, 4, PIN_D0, PIN_D1);                              // '3', pause, '4', '#' = 4
+  poll( wg, 3000);
+  send( 4, 4, PIN_D0, PIN_D1);
+  poll( wg, 150);
+  send( 11, 4, PIN_D0, PIN_D1);
+  poll( wg, 150);
+
+  if ( wg.getKeyCode() != 4) failed++;
+
+  repeats = wg.getRepeatCount() - repeats;
+
+  if ( repeats != 301) failed++;
+
+  wg.setRepeatWindow( WIEGAND_REPEAT_WINDOW, WIEGAND_KEY_DEBOUNCE);
+  wg.setKeyTimeout( WIEGAND_KEY_TIMEOUT);
+
+  printf( "  repeats dropped    %10u  (300 repeated tag frames + 1 bouncing key, PIN timeout %s)\n", repeats, failed ? "failed" : "ok");
+
+  errors += failed;
+}
+
+#if WIEGAND_STATS
+// decoder statistics after sending invalid frames
+static void benchStats( Wiegand& wg)
+{
+  for ( int i = 0; i < 100; i++) {
+    send( encodeW26( i, i) ^ 0x02, 26, PIN_D0, PIN_D1);     // parity error
+    WiegandNative::advance( 30000);
+    wg.available();
+
+    send( 0x2AAAAA, 22, PIN_D0, PIN_D1);                    // no format for bit count
+    WiegandNative::advance( 30000);
+    wg.available();
+  }
+
+  WiegandStats stats;
+
+  wg.getStats( stats);
+
+  printf( "  stats: keys %lu, tags", stats.keys);
+  for ( int i = 0; i < WiegandFormats::count; i++) printf( " W%d = %lu", WiegandFormats::bitCount( i), stats.tags[ i]);
+  printf( "\n  stats: bit count %lu, length %lu, parity %lu, keypad %lu, overruns %lu, repeats %lu, timeouts %lu\n",
+          stats.badBitCount, stats.badLength, stats.badParity, stats.badKeyNibble, stats.overruns, stats.repeats, stats.timeouts);
+  printf( "  stats: ISR (us)     ");
+  for ( int i = 0; i < WIEGAND_STATS_BUCKETS; i++) printf( " %6u", stats.isrTime[ i]);
+  printf( "\n  stats: latency (ms) ");
+  for ( int i = 0; i < WIEGAND_STATS_BUCKETS; i++) printf( " %6u", stats.latency[ i]);
+  printf( "\n");
+
+  if (( stats.badParity != 100) || ( stats.badBitCount != 100)) errors++;
+}
+#endif
+
+// lookup / edit times of the tag database filled to a load factor
+static void benchStore( unsigned int eeprom, int load)
+{
+  EEPROM.resize( eeprom);
+  EEPROM.erase();
+
+  Wiegand_EEPROM* db    = new Wiegand_EEPROM( PIN_IDLE_D0, PIN_IDLE_D1);
+  int             tags  = db->getCapacity() * load / 100;
+  unsigned long   base  = 100000;                           // tags base + 1 .. base + tags are stored
+
+  db->beginBatch();
+  for ( int i = 1; i <= tags; i++) db->createTag( base + i * TAG_STEP, i);
+  db->commitBatch();
+
+  delete db;                                                // measure start-up (open existing table)
+
+  unsigned long      reads = EEPROM.reads();
+  unsigned long long start = now();
+  db = new Wiegand_EEPROM( PIN_IDLE_D0, PIN_IDLE_D1);
+  unsigned long long open  = now() - start;
+  reads = EEPROM.reads() - reads;
+
+  const int          rounds = 2000;
+  unsigned long long hit = 0, miss = 0, edit = 0;
+  unsigned long      hitReads = 0, missReads = 0, writes = 0;
+
+  for ( int r = 0; r < rounds; r++) {
+    unsigned long tag = base + ( 1 + r % tags) * TAG_STEP;
+    unsigned long n   = EEPROM.reads();
+
+    start = now();
+    if ( !db->searchTag( tag)) errors++;
+    hit += now() - start;
+    hitReads += EEPROM.reads() - n;
+
+    n     = EEPROM.reads();
+    start = now();
+    if ( db->searchTag( tag + 1)) errors++;                 // tag not stored
+    miss += now() - start;
+    missReads += EEPROM.reads() - n;
+
+    n     = EEPROM.writes();
+    start = now();
+    if ( !db->deleteTag( tag)) errors++;                    // delete + create = 2 edits
+    if ( !db->createTag( tag, r)) errors++;
+    edit += now() - start;
+    writes += EEPROM.writes() - n;
+  }
+
+  printf( "  %5u bytes %5d slots %3d%% %9.2f %9.2f %7.1f %7.1f %9.2f %7.1f %9.1f %7lu\n",
+          eeprom, db->getCapacity(), load,
+          hit / 1000.0 / rounds, miss / 1000.0 / rounds, ( double) hitReads / rounds, ( double) missReads / rounds,
+          edit / 2000.0 / rounds, ( double) writes / rounds / 2, open / 1000.0, reads);
+
+  delete db;
+}
+
+// import (host -> device, one ACK per frame) and export (device -> host) of a tag database over a simulated link
+static void benchSync( unsigned int eeprom)
+{
+  EEPROM.resize( eeprom);
+  EEPROM.erase();
+
+  Wiegand_EEPROM      db( PIN_IDLE_D0, PIN_IDLE_D1);
+  WiegandNativeStream host( 65536), serial;                 // host buffer holds a complete export
+  WiegandSync         device( db, serial);
+  WiegandSyncLink     link( host);
+  int                 tags     = db.getCapacity() * 90 / 100;
+  unsigned long       base     = 200000;
+  unsigned long       writes   = EEPROM.writes();
+  unsigned long       frames   = 0;
+  byte                payload[ WGSYNC_PAYLOAD];
+  byte                flags    = WGSYNC_REPLACE;
+
+  host.connect( serial);
+
+  unsigned long long start = now();
+
+  for ( int i = 0, sequence = -1; i <= tags; sequence++) {  // HELLO, DATA frames (sequence 0 ..)
+    if ( sequence < 0) {
+      link.send( WGSYNC_HELLO, &flags, 1);
+    } else {
+      int n = ( tags - i < WIEGAND_SYNC_RECORDS) ? tags - i : WIEGAND_SYNC_RECORDS;
+
+      payload[ 0] = sequence;
+      for ( int r = 0; r < n; r++) {
+        WiegandSyncLink::putRecord( payload + 1 + r * WGSYNC_RECORD, WGSYNC_UPSERT, base + ( i + r + 1) * TAG_STEP, i + r);
+      }
+
+      link.send( WGSYNC_DATA, payload, 1 + n * WGSYNC_RECORD);
+      i += n ? n : 1;
+    }
+
+    device.handle();                                        // device applies frame, host waits for ACK
+    frames++;
+
+    if ( !link.receive() || ( link.getPayload()[ 2] != WGSYNC_OK)) errors++;
+  }
+
+  unsigned long long importTime = now() - start;
+  unsigned long      importBytes = host.written() + serial.written();
+
+  writes = EEPROM.writes() - writes;
+
+  for ( int i = 1; i <= tags; i++) {
+    if ( !db.searchTag( base + i * TAG_STEP) || ( db.getKeyCode( db.getSlot()) != ( unsigned long)( i - 1))) errors++;
+  }
+
+  unsigned long exportBytes = serial.written();             // export
+  int           exported    = 0;
+
+  start = now();
+  link.send( WGSYNC_EXPORT, 0, 0);
+  device.handle();
+
+  while ( link.receive() && ( link.getType() == WGSYNC_DATA)) exported += link.getLength() / WGSYNC_RECORD;
+
+  unsigned long long exportTime = now() - start;
+
+  exportBytes = serial.written() - exportBytes;
+
+  if (( exported != tags) || ( link.getType() != WGSYNC_END) || link.getErrors() || device.getErrors()) errors++;
+
+  printf( "  %5u bytes %6d tags %9.2f %9.2f %9.1f %7.1f %9.2f %9.2f\n",
+          eeprom, tags, importTime / 1000.0 / tags, importBytes * 10000.0 / SYNC_BAUD / tags, ( double) writes / tags,
+          ( double) tags / frames, exportTime / 1000.0 / tags, exportBytes * 10000.0 / SYNC_BAUD / tags);
+}
+
+// access decisions of a reader with rules (tag, tag + PIN, door, schedule) and cost of a rule check
+static void benchRules()
+{
+  EEPROM.resize( 1024);
+  EEPROM.erase();
+
+  WiegandStorage_EEPROM tagRegion( 0, 512);                 // tag table + log behind it
+  WiegandStorage_EEPROM logRegion( 512, 512);
+  Wiegand_EEPROM        db( PIN_RULES_D0, PIN_RULES_D1, tagRegion);
+  WiegandRules          rules;
+  WiegandLog            log( logRegion);
+  int                   failed = 0;
+
+  rules.setDoors( 1, 0x01);                                 // group 1 = door 0, weekdays 08:00 .. 18:00
+  rules.allow( 1, WG_WEEKDAYS, 8 * 60, 18 * 60);
+  rules.setDoors( 2, 0x02);                                 // group 2 = door 1 only
+  rules.allow( 2, WG_ALLDAYS, 0, 0);
+  rules.setTime( 0, 9, 0);                                  // Monday 09:00
+
+  db.begin();
+  db.setRules( rules, 0);
+  log.begin();
+  db.setLog( log);
+  db.createTag( 1001, 0,    1);
+  db.createTag( 1002, 1234, 1);
+  db.createTag( 1003, 0,    2);
+  db.createTag( 1004, 0);                                   // group 0 = no rule
+
+  struct { unsigned long card; long pin; byte day; WiegandAccess access; } steps[] = {
+    { 1001, -1,   0, WG_GRANTED     },
+    { 1002, -1,   0, WG_ENTER_PIN   },
+    { 0,    1234, 0, WG_GRANTED     },                      // PIN of tag before
+    { 1002, -1,   0, WG_ENTER_PIN   },
+    { 0,    9999, 0, WG_BAD_PIN     },
+    { 1003, -1,   0, WG_WRONG_DOOR  },
+    { 1001, -1,   5, WG_OUT_OF_TIME },                      // Saturday
+    { 1004, -1,   5, WG_GRANTED     },
+    { 1999, -1,   0, WG_UNKNOWN     },
+    { 0,    1234, 0, WG_UNKNOWN     },                      // PIN without tag
+  };
+
+  for ( unsigned int i = 0; i < sizeof( steps) / sizeof( steps[ 0]); i++) {
+    rules.setTime( steps[ i].day, 9, 0);
+
+    if ( steps[ i].card) {
+      send( encodeW26( 0, steps[ i].card), 26, PIN_RULES_D0, PIN_RULES_D1);
+    } else {
+      for ( long d = 100000; d; d /= 10) {                  // 6 digits + '#' (4 bit keypad frames)
+        send( ( steps[ i].pin / d) % 10, 4, PIN_RULES_D0, PIN_RULES_D1);
+        WiegandNative::advance( 30000);
+        db.available();
+      }
+
+      send( 11, 4, PIN_RULES_D0, PIN_RULES_D1);
+    }
+
+    WiegandNative::advance( 30000);
+
+    if ( !db.available() || ( db.getAccess() != steps[ i].access)) failed++;
+  }
+
+  uint16_t         cursor = log.first();                    // one record per decision (PIN digits not logged)
+  WiegandLogRecord record;
+
+  for ( unsigned int i = 0; i < sizeof( steps) / sizeof( steps[ 0]); i++) {
+    if ( !log.read( cursor, record) || ( record.access != steps[ i].access)) failed++;
+  }
+
+  if ( log.read( cursor, record)) failed++;
+
+  if ( rules.check( WG_KEY( 1, 0), 8)  != WG_WRONG_DOOR) failed++;
+  if ( rules.check( WG_KEY( 2, 0), 33) != WG_WRONG_DOOR) failed++;
+                                                            // doors outside the mask (byte) never match
+  const long         checks = 1000000;
+  unsigned long      keys[] = { WG_KEY( 1, 0), WG_KEY( 2, 0), WG_KEY( 0, 0), WG_KEY( 3, 0) };
+  int                granted = 0;
+  unsigned long long start   = now();
+
+  for ( long i = 0; i < checks; i++) granted += rules.check( keys[ i & 3], i & 1) == WG_GRANTED;
+
+  double check = ( double)( now() - start) / checks;
+
+  printf( "\nrules     (WIEGAND_RULES_GROUPS = %d, WIEGAND_RULES_SLOT = %d min, %d bytes)\n",
+          WIEGAND_RULES_GROUPS, WIEGAND_RULES_SLOT, ( int) sizeof( WiegandRules));
+  printf( "  rule check           %10.1f ns  (%d granted)\n", check, granted);
+  printf( "  decisions            %10s\n", failed ? "failed" : "ok");
+
+  errors += failed;
+}
+
+// reader asleep in idle() between frames of the transmitter (latency after last bit, share of time asleep)
+static void benchIdle( Wiegand& wg, WiegandOut& out, long frames)
+{
+  unsigned long latency = 0;                                // simulated time last bit .. idle() returned (us)
+  unsigned long total   = 0;                                // simulated time of all frames (us)
+  unsigned long slept   = WiegandNative::slept();
+  int           failed  = 0;
+
+  while ( wg.available());                                  // codes not seen yet = idle() returns at once
+
+  srand( 3);
+
+  for ( long i = 0; i < frames; i++) {
+    unsigned long facility = rand() & 0xFF;
+    unsigned long card     = rand() & 0xFFFF;
+    unsigned long sent     = micros();
+
+    if ( !out.sendTag( facility, card, 26)) failed++;
+
+    bool woken = Wiegand::idle( 1000);                      // 1 s = frame lost
+
+    latency += micros() - ( sent + 25 * PULSE_INTERVAL);    // first bit sent at once, then 25 bit intervals
+    total   += micros() - sent;
+
+    if ( !woken || !wg.available() || ( wg.getFacilityCode() != facility) || ( wg.getCardNumber() != card)) {
+      if ( failed++ < 5) printf( "error: W26 frame %ld (facility %lu card %lu) not received in idle\n", i, facility, card);
+    }
+
+    while ( out.busy()) WiegandNative::advance( POLL_INTERVAL);
+  }
+
+  slept = WiegandNative::slept() - slept;
+
+  unsigned long start = millis();                           // no traffic = limit returns
+  bool          woken = Wiegand::idle( 100);
+  unsigned long quiet = millis() - start;
+
+  if ( woken || ( quiet < 100) || ( quiet > 102)) failed++;
+
+  printf( "\nidle      (W26 loopback, %ld frames, reader asleep in Wiegand::idle)\n", frames);
+  printf( "  read latency         %10.2f ms  (last bit .. idle returns)\n", latency / 1000.0 / frames);
+  printf( "  time asleep          %10.1f %%\n", total ? 100.0 * slept / total : 0.0);
+  printf( "  time limit           %10lu ms  (idle( 100), no traffic)\n", quiet);
+  printf( "  wake on frame        %10s\n", failed ? "failed" : "ok");
+
+  errors += failed;
+}
+
+// loopback of the transmitter into the reader (tags of each length, relayed frames, PIN) and cost per frame
+static void benchOut( Wiegand& wg, long frames)
+{
+  WiegandOut         out( PIN_OUT_D0, PIN_OUT_D1);
+  unsigned long long queueTime = 0;                         // host time of sendTag()
+  unsigned long long airTime   = 0;                         // host time until frame received (timer + reader ISR)
+  unsigned long      air       = 0;                         // simulated time sendTag() .. available()
+  int                failed    = 0;
+
+  WiegandNative::connect( PIN_OUT_D0, PIN_D0);
+  WiegandNative::connect( PIN_OUT_D1, PIN_D1);
+
+  if ( !out.begin()) failed++;
+
+  byte lengths[] = { 26, 34 };                              // formats enabled by default
+
+  srand( 2);
+
+  for ( long i = 0; i < frames; i++) {
+    byte          bits     = lengths[ i & 1];
+    unsigned long facility = rand() & 0xFF;
+    unsigned long card     = rand() & 0xFFFF;
+    unsigned long sent     = micros();
+
+    unsigned long long start = now();
+    if ( !out.sendTag( facility, card, bits)) failed++;
+    queueTime += now() - start;
+
+    bool done = false;
+
+    start = now();
+
+    for ( int poll = 0; !done && ( poll < 1000); poll++) {
+      done = wg.available();
+
+      if ( !done) WiegandNative::advance( POLL_INTERVAL);
+    }
+
+    airTime += now() - start;
+    air     += micros() - sent;
+
+    if ( !done || ( wg.getBitCount() != bits) || ( wg.getFacilityCode() != facility) || ( wg.getCardNumber() != card)) {
+      if ( failed++ < 5) printf( "error: W%d frame %ld (facility %lu card %lu) not received\n", bits, i, facility, card);
+    }
+
+    if ( !out.relay( wg)) failed++;                         // same frame again (as received)
+
+    for ( int poll = 0; !( done = wg.available()) && ( poll < 1000); poll++) WiegandNative::advance( POLL_INTERVAL);
+
+    if ( !done || ( wg.getFacilityCode() != facility) || ( wg.getCardNumber() != card)) failed++;
+
+    while ( out.busy()) WiegandNative::advance( POLL_INTERVAL);
+  }
+
+  bool pin = !out.sendPin( 12345678) && !out.pending();     // 9 frames do not fit = none queued
+  pin = pin && !out.send(( uint64_t) 0, 0);                 // empty frame refused
+
+  const unsigned long pins[] = { 1234, 123456 };            // 4 digit PIN, 6 digit PIN (7 frames = queue full)
+
+  for ( byte p = 0; p < 2; p++) {
+    pin = pin && out.sendPin( pins[ p]);
+
+    if ( p == 1) pin = pin && !out.sendKey( 1);             // no room left
+
+    bool done = false;
+
+    for ( int poll = 0; !done && ( poll < 1000); poll++) {
+      done = wg.available();
+
+      if ( !done) WiegandNative::advance( POLL_INTERVAL);
+    }
+
+    if ( !pin || !done || ( wg.getKeyCode() != pins[ p])) failed++;
+
+    while ( out.busy()) WiegandNative::advance( POLL_INTERVAL);
+  }
+
+  printf( "\ntransmit  (W26 / W34 + relay, %ld frames, WIEGAND_OUT_QUEUE = %d)\n", frames, WIEGAND_OUT_QUEUE);
+  printf( "  queue per frame      %10.1f ns  (sendTag)\n", ( double) queueTime / frames);
+  printf( "  frame on air         %10.1f us  (host, timer + reader ISR + loop)\n", airTime / 1000.0 / frames);
+  printf( "  send latency         %10.2f ms  (sendTag .. available)\n", air / 1000.0 / frames);
+  printf( "  loopback             %10s\n", failed ? "failed" : "ok");
+
+  errors += failed;
+  benchIdle( wg, out, frames);                              // transmitter still connected
+
+  WiegandNative::connect( PIN_OUT_D0, -1);
+  WiegandNative::connect( PIN_OUT_D1, -1);
+}
+
+#if WIEGAND_CAPTURE
+// frames captured as edges and written as trace, trace replayed into the reader (same codes expected)
+static void benchCapture( Wiegand& wg, long frames)
+{
+  WiegandNativeStream trace( 1 << 20);                      // loopback = trace read back from the same stream
+  WiegandTraceWriter  writer( trace);
+  WiegandTraceReader  reader;
+  WiegandEdge         edge;
+  uint64_t*           codes    = new uint64_t[ frames];
+  unsigned long long  dumpTime = 0;
+  unsigned long       edges    = 0;
+  unsigned long       elapsed  = 0;                         // simulated time of replay (us)
+  int                 failed   = 0;
+
+  while ( wg.readEdge( edge));                              // edges of previous benches
+
+  unsigned long lost = wg.getEdgesLost();
+
+  srand( 3);
+
+  for ( long i = 0; i < frames; i++) {
+    send( encodeW26( rand() & 0xFF, rand() & 0xFFFF), 26, PIN_D0, PIN_D1);
+
+    if ( poll( wg, 30) != 1) failed++;                      // frame reported
+    codes[ i] = wg.getCode64();
+
+    unsigned long long start = now();
+    edges    += wg.dumpTrace( writer);                      // after each frame (ring holds 64 edges)
+    dumpTime += now() - start;
+
+    WiegandNative::advance(( rand() % 1000) * 1000UL);      // card presented 0 .. 1 s later
+  }
+
+  writer.end();
+
+  if ( wg.getEdgesLost() != lost) failed++;                 // ring overrun (dump after each frame = none)
+
+  unsigned long bytes = trace.written();
+  unsigned long last  = 0;
+  long          index = 0;
+
+  unsigned long long start = now();
+
+  for ( int c = 0; c >= 0; ) {                              // replay as wgreplay does (without gap skipping)
+    c = trace.read();
+
+    if ( !reader.parse( c, edge)) continue;
+
+    unsigned long gap = edge.time - last;
+
+    elapsed += gap;
+    for ( unsigned long t = 0; t < gap; t += POLL_INTERVAL) {
+      if ( wg.available() && (( index >= frames) || ( wg.getCode64() != codes[ index++]))) failed++;
+
+      WiegandNative::advance(( gap - t < POLL_INTERVAL) ? gap - t : POLL_INTERVAL);
+    }
+
+    WiegandNative::setPin( edge.line ? PIN_D1 : PIN_D0, LOW);
+    WiegandNative::setPin( edge.line ? PIN_D1 : PIN_D0, HIGH);
+    last = edge.time;
+  }
+
+  for ( int t = 0; t < 30; t++) {                           // last frame
+    if ( wg.available() && (( index >= frames) || ( wg.getCode64() != codes[ index++]))) failed++;
+
+    WiegandNative::advance( POLL_INTERVAL);
+  }
+
+  double replayTime = ( now() - start) / 1e9;
+
+  if (( index != frames) || ( edges != frames * 26UL) || reader.getErrors()) failed++;
+
+  while ( wg.readEdge( edge));                              // edges of replay (ring overrun)
+
+  printf( "\ncapture   (WIEGAND_CAPTURE = %d edges, %ld W26 frames)\n", WIEGAND_CAPTURE, frames);
+  printf( "  trace per frame      %10.1f bytes  (text, one line per frame)\n", ( double) bytes / frames);
+  printf( "  dump per edge        %10.1f ns  (dumpTrace)\n", ( double) dumpTime / edges);
+  printf( "  replay               %10.0fx real time  (%.1f s traffic, loop polled every %d us)\n",
+          elapsed / 1e6 / replayTime, elapsed / 1e6, POLL_INTERVAL);
+  printf( "  codes replayed       %10s\n", failed ? "failed" : "ok");
+
+  delete[] codes;
+  errors += failed;
+}
+#endif
+
+// staging cost, bytes written per record, restart (newest record found) and read out of the event log ring
+static void benchLog( unsigned int eeprom)
+{
+  EEPROM.resize( eeprom);
+  EEPROM.erase();
+
+  WiegandStorage_EEPROM region( 0, eeprom);
+  WiegandLog*           log    = new WiegandLog( region);
+  int                   failed = 0;
+
+  log->begin();
+  log->setTime( 1500000000UL);
+
+  const long         records = 3L * log->getCapacity() + 5;  // ring wraps 3 times
+  unsigned long long stage   = 0;
+  unsigned long      writes  = EEPROM.writes();
+
+  for ( long i = 0; i < records; i++) {
+    unsigned long long start = now();
+    log->add( 100000 + i, i % 100, ( i & 1) ? WG_GRANTED : WG_UNKNOWN, i & 3);
+    stage += now() - start;
+
+    WiegandNative::advance( 250000);                        // one access every 250 ms, loop calls handle()
+    log->handle();
+  }
+
+  log->flush();
+  writes = EEPROM.writes() - writes;
+
+  delete log;                                               // restart: find newest record
+
+  unsigned long      reads = EEPROM.reads();
+  unsigned long long start = now();
+  log = new WiegandLog( region);
+  log->begin();
+  unsigned long long open  = now() - start;
+  reads = EEPROM.reads() - reads;
+
+  if (( log->getCount() != log->getCapacity()) || ( log->end() != ( uint16_t) records)) failed++;
+
+  uint16_t         cursor = log->first();
+  uint16_t         next   = cursor;
+  WiegandLogRecord record;
+  long             count  = 0;
+
+  start = now();
+
+  while ( log->read( cursor, record)) {                     // oldest .. newest, no gaps
+    if (( record.sequence != next++) || ( record.tag != 100000UL + record.sequence)) failed++;
+    count++;
+  }
+
+  unsigned long long readout = now() - start;
+
+  if ( count != log->getCapacity()) failed++;
+
+  EEPROM.write(( int)((( log->end() - 1) % log->getCapacity()) * sizeof( WiegandLogRecord) + 4), 0x00);
+                                                            // newest record damaged (write interrupted)
+  delete log;
+  log = new WiegandLog( region);
+  log->begin();
+
+  if (( log->end() != ( uint16_t)( records - 1)) || ( log->getCount() != log->getCapacity() - 1)) failed++;
+
+  EEPROM.write(( int)((( log->first() + 1) % log->getCapacity()) * sizeof( WiegandLogRecord) + 4), 0x00);
+                                                            // record next to oldest damaged
+  delete log;
+  log = new WiegandLog( region);
+  log->begin();
+
+  cursor = log->first();                                    // oldest record still first, damaged record skipped
+  count  = 0;
+
+  while ( log->read( cursor, record)) count++;
+
+  if (( log->getCount() != log->getCapacity() - 1) || ( count != ( long) log->getCapacity() - 2)) failed++;
+
+  delete log;
+
+  printf( "  %5u bytes %5u records %9.1f %9.2f %9.1f %7lu %9.1f\n",
+          eeprom, eeprom / ( unsigned int) sizeof( WiegandLogRecord), ( double) stage / records, ( double) writes / records,
+          open / 1000.0, reads, ( double) readout / count);
+
+  errors += failed;
+}
+
+int main( int argc, char** argv)
+{
+  long frames = ( argc > 1) ? atol( argv[ 1]) : 20000;
+
+  Wiegand wg( PIN_D0, PIN_D1);
+
+  wg.begin();
+
+  #if WIEGAND_TIMER
+  wg.onTag( tagReceived);                                   // frames reported by timer context
+  #endif
+  benchDecoder( wg, frames);
+  benchIntervals( wg);
+  benchRepeat( wg);
+
+  #if WIEGAND_STATS
+  benchStats( wg);
+  #endif
+
+  benchOut( wg, frames / 10);
+
+  #if WIEGAND_CAPTURE
+  benchCapture( wg, frames / 10);
+  #endif
+
+  benchRules();
+
+  printf( "\ndatabase  (WIEGAND_EEPROM_CACHE = %d, WIEGAND_EEPROM_JOURNAL = %d, WIEGAND_EEPROM_BLOOM = %d, %d bytes per slot, MAX_TAGS = %d)\n",
+          WIEGAND_EEPROM_CACHE, WIEGAND_EEPROM_JOURNAL, WIEGAND_EEPROM_BLOOM, WIEGAND_EEPROM_RECORD, ( int) MAX_TAGS);
+  printf( "  storage     capacity   load   hit(us)  miss(us)  rd/hit rd/miss  edit(us) wr/edit   open(us) rd/open\n");
+
+  unsigned int sizes[] = { 1024, 4096, 32768 };
+  int          count   = WIEGAND_EEPROM_CACHE ? 3 : 1;      // RAM copy = MAX_TAGS slots only
+
+  for ( int i = 0; i < count; i++) {
+    benchStore( sizes[ i], 50);
+    benchStore( sizes[ i], 90);
+  }
+
+  printf( "\nsync      (WIEGAND_SYNC_RECORDS = %d, %d baud)\n", WIEGAND_SYNC_RECORDS, SYNC_BAUD);
+  printf( "  storage         tags  import(us)  link(ms)  wr/tag  tags/frame export(us) link(ms)  (per tag)\n");
+
+  for ( int i = 0; i < count; i++) benchSync( sizes[ i]);
+
+  printf( "\nlog       (WIEGAND_LOG_BUFFER = %d, WIEGAND_LOG_DELAY = %d ms, %d bytes per record)\n",
+          WIEGAND_LOG_BUFFER, WIEGAND_LOG_DELAY, ( int) sizeof( WiegandLogRecord));
+  printf( "  storage        capacity  add(ns)  wr/record  open(us) rd/open  read(ns)\n");
+
+  for ( int i = 0; i < count; i++) benchLog( sizes[ i]);
+
+  if ( errors) printf( "\n%d errors\n", errors);
+
+  return errors ? 1 : 0;
+}
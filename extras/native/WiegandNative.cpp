@@ -0,0 +1,460 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host)
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandNative.cpp
+// Purpose    : Host backend of WiegandPlatform.h (simulated clock, pins, interrupts and EEPROM file)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "WiegandNative.h"
+
+WiegandNativeSerial Serial;
+WiegandNativeEEPROM EEPROM;
+
+static unsigned long _micros = 0;                           // simulated time (us)
+static byte          _level[ WIEGAND_NATIVE_PINS];          // pin levels (0 = not driven = high)
+static byte          _mode [ WIEGAND_NATIVE_PINS];          // interrupt mode per pin (0 = not attached)
+static void        (*_isr  [ WIEGAND_NATIVE_PINS])();       // attached interrupt handlers
+static void        (*_pending[ 2 * WIEGAND_NATIVE_PINS])(); // interrupts held back by noInterrupts
+static int           _pendingPort[ 2 * WIEGAND_NATIVE_PINS]; // port of pin change interrupts held back (-1 = external)
+static int           _pendingCount = 0;
+static bool          _disabled     = false;                 // true = between noInterrupts / interrupts
+static unsigned long _edges        = 0;                     // interrupts fired
+static unsigned long _slept        = 0;                     // time asleep (us)
+static void        (*_timer)()     = 0;                     // periodic timer interrupt
+static unsigned long _timerPeriod  = 0;                     // us
+static unsigned long _timerNext    = 0;                     // time of next timer interrupt (us)
+static void        (*_alarm)()     = 0;                     // one shot timer interrupt
+static unsigned long _alarmTime    = 0;                     // time of one shot timer interrupt (us)
+static int           _wire[ WIEGAND_NATIVE_PINS];           // input pin driven by output pin (-1 = none)
+static volatile uint8_t _port  [ WIEGAND_NATIVE_PINS / 8];  // input registers (bit set = high)
+static byte          _pcMask[ WIEGAND_NATIVE_PINS / 8];     // pin change interrupt masks per port
+static void        (*_pcISR [ WIEGAND_NATIVE_PINS / 8])( byte);
+                                                            // pin change interrupt handlers per port
+
+static struct WiegandNativeStart {
+  WiegandNativeStart() { WiegandNative::reset(); }          // all pins high at start
+} WiegandNativeStarted;
+
+unsigned long millis()
+{
+  return _micros / 1000;
+}
+
+unsigned long micros()
+{
+  return _micros;
+}
+
+void delay( unsigned long ms)
+{
+  WiegandNative::advance( ms * 1000);
+}
+
+void delayMicroseconds( unsigned int us)
+{
+  WiegandNative::advance( us);
+}
+
+void pinMode( int, int)
+{
+}
+
+int digitalRead( int pin)
+{
+  if (( pin < 0) || ( pin >= WIEGAND_NATIVE_PINS)) return HIGH;
+
+  return _level[ pin] ? LOW : HIGH;                         // inputs idle high (pull-up)
+}
+
+void digitalWrite( int pin, int value)
+{
+  if (( pin < 0) || ( pin >= WIEGAND_NATIVE_PINS)) return;
+
+  _level[ pin] = ( value == LOW);                           // output pins have no interrupt
+
+  if ( value == LOW) {
+    _port[ pin >> 3] &= ~( 1 << ( pin & 0x07));
+  } else {
+    _port[ pin >> 3] |=  ( 1 << ( pin & 0x07));
+  }
+
+  if ( _wire[ pin] >= 0) WiegandNative::setPin( _wire[ pin], value);
+}
+
+void attachInterrupt( int pin, void ( *isr)(), int mode)
+{
+  if (( pin < 0) || ( pin >= WIEGAND_NATIVE_PINS)) return;
+
+  _isr [ pin] = isr;
+  _mode[ pin] = mode;
+}
+
+void detachInterrupt( int pin)
+{
+  if (( pin < 0) || ( pin >= WIEGAND_NATIVE_PINS)) return;
+
+  _isr [ pin] = 0;
+  _mode[ pin] = 0;
+}
+
+void noInterrupts()
+{
+  _disabled = true;
+}
+
+void interrupts()
+{
+  _disabled = false;
+
+  for ( int i = 0; i < _pendingCount; i++) {                // fire interrupts held back (in order)
+    _edges++;
+
+    if ( _pendingPort[ i] < 0) {
+      _pending[ i]();
+    } else {
+      _pcISR[ _pendingPort[ i]]( _pendingPort[ i]);
+    }
+  }
+
+  _pendingCount = 0;
+}
+
+size_t WiegandNativeSerial::print( const char* s)
+{
+  return fputs( s, stdout) >= 0 ? strlen( s) : 0;
+}
+
+size_t WiegandNativeSerial::print( char c)
+{
+  return fputc( c, stdout) != EOF ? 1 : 0;
+}
+
+size_t WiegandNativeSerial::print( unsigned long n, int base)
+{
+  return printf( base == 16 ? "%lX" : ( base == 8 ? "%lo" : "%lu"), n);
+}
+
+size_t WiegandNativeSerial::print( long n, int base)
+{
+  return ( base == 10) ? printf( "%ld", n) : print(( unsigned long) n, base);
+}
+
+size_t WiegandNativeSerial::println()
+{
+  return print( '\n');
+}
+
+WiegandNativeStream::WiegandNativeStream( unsigned int size)
+{
+  _data    = ( uint8_t*) malloc( size);
+  _size    = size;
+  _head    = 0;
+  _tail    = 0;
+  _peer    = this;                                          // loopback until connected
+  _written = 0;
+}
+
+WiegandNativeStream::~WiegandNativeStream()
+{
+  free( _data);
+}
+
+void WiegandNativeStream::connect( WiegandNativeStream& peer)
+{
+  _peer      = &peer;
+  peer._peer = this;
+}
+
+int WiegandNativeStream::available()
+{
+  return ( _head + _size - _tail) % _size;
+}
+
+int WiegandNativeStream::read()
+{
+  if ( _head == _tail) return -1;
+
+  uint8_t value = _data[ _tail];
+
+  _tail = ( _tail + 1) % _size;
+  return value;
+}
+
+int WiegandNativeStream::peek()
+{
+  return ( _head == _tail) ? -1 : _data[ _tail];
+}
+
+size_t WiegandNativeStream::write( uint8_t value)
+{
+  if ( !_peer->_receive( value)) return 0;                  // receiver full (as a blocked serial link)
+
+  _written++;
+  return 1;
+}
+
+unsigned long WiegandNativeStream::written()
+{
+  return _written;
+}
+
+bool WiegandNativeStream::_receive( uint8_t value)
+{
+  unsigned int next = ( _head + 1) % _size;
+
+  if ( next == _tail) return false;
+
+  _data[ _head] = value;
+  _head         = next;
+  return true;
+}
+
+WiegandNativeEEPROM::WiegandNativeEEPROM()
+{
+  _data   = 0;
+  _size   = 0;
+  _file   = 0;
+  _writes = 0;
+  _reads  = 0;
+
+  resize( WIEGAND_NATIVE_EEPROM);
+}
+
+void WiegandNativeEEPROM::begin( unsigned int size)
+{
+  if ( size > _size) resize( size);
+}
+
+void WiegandNativeEEPROM::resize( unsigned int size)
+{
+  if (( size == _size) || ( size == 0)) return;
+
+  _data = ( uint8_t*) realloc( _data, size);
+
+  if ( size > _size) memset( _data + _size, 0xFF, size - _size);
+                                                            // new bytes = erased
+  _size = size;
+}
+
+bool WiegandNativeEEPROM::commit()
+{
+  if ( !_file) return true;
+
+  FILE* f = fopen( _file, "wb");
+
+  if ( !f) return false;
+
+  bool done = fwrite( _data, 1, _size, f) == _size;
+
+  fclose( f);
+  return done;
+}
+
+uint8_t WiegandNativeEEPROM::read( int address)
+{
+  _reads++;
+
+  return (( address >= 0) && (( unsigned int) address < _size)) ? _data[ address] : 0xFF;
+}
+
+void WiegandNativeEEPROM::write( int address, uint8_t value)
+{
+  if (( address < 0) || (( unsigned int) address >= _size)) return;
+
+  if ( _data[ address] != value) _writes++;                 // count changed bytes only (wear)
+  _data[ address] = value;
+}
+
+void WiegandNativeEEPROM::update( int address, uint8_t value)
+{
+  if (( address < 0) || (( unsigned int) address >= _size)) return;
+
+  if ( _data[ address] != value) write( address, value);
+}
+
+uint16_t WiegandNativeEEPROM::length()
+{
+  return _size > 0xFFFF ? 0xFFFF : _size;
+}
+
+bool WiegandNativeEEPROM::open( const char* file)
+{
+  FILE* f = fopen( _file = file, "rb");
+
+  erase();
+
+  if ( !f) return false;                                    // new file (written on commit)
+
+  size_t size = fread( _data, 1, _size, f);
+
+  fclose( f);
+  return size > 0;
+}
+
+void WiegandNativeEEPROM::erase()
+{
+  memset( _data, 0xFF, _size);
+}
+
+unsigned long WiegandNativeEEPROM::writes()
+{
+  return _writes;
+}
+
+unsigned long WiegandNativeEEPROM::reads()
+{
+  return _reads;
+}
+
+void WiegandNative::advance( unsigned long us)
+{
+  unsigned long end = _micros + us;
+
+  for (;;) {                                                // timer interrupts due until end (in order)
+    bool timer = _timer && (( long)( _timerNext - end) <= 0);
+    bool alarm = _alarm && (( long)( _alarmTime - end) <= 0);
+
+    if ( alarm && ( !timer || (( long)( _alarmTime - _timerNext) < 0))) {
+      void ( *isr)() = _alarm;
+
+      _micros = _alarmTime;
+      _alarm  = 0;                                          // one shot (may be set again by isr)
+      isr();
+    } else if ( timer) {
+      _micros     = _timerNext;
+      _timerNext += _timerPeriod;
+      _timer();
+    } else {
+      break;
+    }
+  }
+
+  _micros = end;
+}
+
+void WiegandNative::alarm( void ( *isr)(), unsigned long us)
+{
+  _alarm     = us ? isr : 0;
+  _alarmTime = _micros + us;
+}
+
+void WiegandNative::connect( int output, int input)
+{
+  if (( output < 0) || ( output >= WIEGAND_NATIVE_PINS)) return;
+
+  _wire[ output] = input;
+}
+
+void WiegandNative::timer( void ( *isr)(), unsigned long period)
+{
+  _timer       = period ? isr : 0;
+  _timerPeriod = period;
+  _timerNext   = _micros + period;
+}
+
+void WiegandNative::setPin( int pin, int value)
+{
+  if (( pin < 0) || ( pin >= WIEGAND_NATIVE_PINS)) return;
+
+  byte low  = ( value == LOW);
+  bool fire = ( _mode[ pin] == CHANGE)  ? ( low != _level[ pin]) :
+              ( _mode[ pin] == FALLING) ? ( low && !_level[ pin]) :
+              ( _mode[ pin] == RISING)  ? ( !low && _level[ pin]) : false;
+
+  byte group  = pin >> 3;
+  byte mask   = 1 << ( pin & 0x07);
+  bool change = ( low != _level[ pin]) && ( _pcMask[ group] & mask) && _pcISR[ group];
+
+  _level[ pin] = low;
+
+  if ( low) {
+    _port[ group] &= ~mask;
+  } else {
+    _port[ group] |=  mask;
+  }
+
+  if ( fire && _isr[ pin]) _interrupt( _isr[ pin]);         // external interrupt
+  if ( change)             _interrupt( 0, group);           // pin change interrupt
+}
+
+void WiegandNative::_interrupt( void ( *isr)(), int group)
+{
+  if ( _disabled) {
+    if ( _pendingCount < 2 * WIEGAND_NATIVE_PINS) {
+      _pending    [ _pendingCount]   = isr;
+      _pendingPort[ _pendingCount++] = group;
+    }
+  } else {
+    _edges++;
+
+    if ( group < 0) {
+      isr();                                                // interrupt fires at the edge
+    } else {
+      _pcISR[ group]( group);
+    }
+  }
+}
+
+void WiegandNative::pinChange( byte group, byte mask, void ( *isr)( byte))
+{
+  if ( group >= WIEGAND_NATIVE_PINS / 8) return;
+
+  _pcMask[ group] |= mask;                                  // as PCMSKn |= mask
+  _pcISR [ group]  = isr;
+}
+
+volatile uint8_t& WiegandNative::port( byte group)
+{
+  return _port[ group % ( WIEGAND_NATIVE_PINS / 8)];
+}
+
+void WiegandNative::pulse( int pin, unsigned int width)
+{
+  setPin( pin, LOW);
+  advance( width);
+  setPin( pin, HIGH);
+}
+
+unsigned long WiegandNative::edges()
+{
+  return _edges;
+}
+
+void WiegandNative::sleep()
+{
+  unsigned long end = _micros + 1000;                       // timer 0 overflow (millis) wakes an AVR in idle mode
+
+  if ( _alarm && (( long)( _alarmTime - end) < 0)) end = _alarmTime;
+  if ( _timer && (( long)( _timerNext - end) < 0)) end = _timerNext;
+  if (( long)( end - _micros) < 0)                   end = _micros;
+
+  _slept += end - _micros;
+  advance( end - _micros);                                  // interrupt at end = wake-up
+}
+
+unsigned long WiegandNative::slept()
+{
+  return _slept;
+}
+
+void WiegandNative::reset()
+{
+  _micros       = 0;
+  _pendingCount = 0;
+  _disabled     = false;
+  _edges        = 0;
+  _slept        = 0;
+  _timer        = 0;
+  _alarm        = 0;
+
+  memset( _level, 0, sizeof( _level));
+  memset( _mode,  0, sizeof( _mode));
+  memset( _isr,   0, sizeof( _isr));
+  memset(( void*) _port, 0xFF, sizeof( _port));
+  memset( _pcMask, 0, sizeof( _pcMask));
+  memset( _pcISR,  0, sizeof( _pcISR));
+  memset( _wire,  -1, sizeof( _wire));                      // int -1 = all bytes 0xFF
+}
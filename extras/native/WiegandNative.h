@@ -0,0 +1,183 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host)
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandNative.h
+// Purpose    : Host backend of WiegandPlatform.h (simulated clock, pins, interrupts and EEPROM file)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_NATIVE_H
+#define _WIEGAND_NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef WIEGAND_NATIVE_PINS
+#define WIEGAND_NATIVE_PINS 64                              // simulated pins (pin = interrupt number)
+#endif
+
+#ifndef WIEGAND_NATIVE_EEPROM
+#define WIEGAND_NATIVE_EEPROM 1024                          // default EEPROM size (ATmega328P)
+#endif
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH         0x1
+#define LOW          0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE       1
+#define FALLING      2
+#define RISING       3
+
+#define F( s)                     ( s)
+#define PROGMEM                                             // flash = RAM on host
+#define pgm_read_ptr( p)          ( *( const void* const*)( p))
+
+class __FlashStringHelper;                                  // flash string (F / PROGMEM) = plain string on host
+#define digitalPinToInterrupt( p) (( p) < WIEGAND_NATIVE_PINS ? ( p) : -1)
+
+unsigned long millis();                                     // simulated time (ms)
+unsigned long micros();                                     // simulated time (us)
+void          delay( unsigned long);                        // advance simulated time (ms)
+void          delayMicroseconds( unsigned int);             // advance simulated time (us)
+inline void   yield() {}
+
+void pinMode( int, int);
+int  digitalRead( int);
+void digitalWrite( int, int);                               // output pins only (inputs are driven by WiegandNative::setPin)
+
+void attachInterrupt( int, void (*)(), int);
+void detachInterrupt( int);
+void noInterrupts();                                        // edges are held back until interrupts()
+void interrupts();
+
+// console output (debug prints of the library)
+class WiegandNativeSerial {
+public:
+  void   begin( unsigned long) {}
+  size_t print( const char*);
+  size_t print( const __FlashStringHelper* s) { return print(( const char*) s); }
+  size_t print( char);
+  size_t print( unsigned long, int = 10);
+  size_t print( long, int = 10);
+  size_t print( int n, int base = 10) { return print(( long) n, base); }
+  size_t print( unsigned int n, int base = 10) { return print(( unsigned long) n, base); }
+  size_t println();
+  size_t println( const char* s) { return print( s) + println(); }
+};
+
+// byte stream (as Stream of the Arduino core, e.g. Serial)
+class Stream {
+public:
+  virtual ~Stream() {}
+
+  virtual int    available() = 0;                           // bytes ready to be read
+  virtual int    read() = 0;                                // next byte (-1 = none)
+  virtual int    peek() = 0;                                // next byte, not removed (-1 = none)
+  virtual size_t write( uint8_t) = 0;
+  virtual size_t write( const uint8_t* buffer, size_t size)
+  {
+    size_t n = 0;
+
+    while (( n < size) && write( buffer[ n])) n++;
+    return n;
+  }
+  virtual void   flush() {}
+};
+
+// in memory byte stream; bytes written are read from the connected stream (e.g. host side <-> Serial)
+class WiegandNativeStream : public Stream {
+public:
+  WiegandNativeStream( unsigned int = 4096);                // buffer size (bytes received, not yet read)
+  ~WiegandNativeStream();
+
+  void   connect( WiegandNativeStream&);                    // connect both ends (unconnected = loopback)
+  int    available();
+  int    read();
+  int    peek();
+  size_t write( uint8_t);
+  using  Stream::write;
+
+  unsigned long written();                                  // bytes written since start (link load)
+
+protected:
+  uint8_t*             _data;                               // bytes received (ring buffer)
+  unsigned int         _size;
+  unsigned int         _head;                               // next byte to be written
+  unsigned int         _tail;                               // next byte to be read
+  WiegandNativeStream* _peer;                               // receiving end of bytes written
+  unsigned long        _written;
+
+  bool   _receive( uint8_t);                                // store received byte (false = buffer full)
+};
+
+// EEPROM in RAM, loaded from / saved to a file (optional)
+class WiegandNativeEEPROM {
+public:
+  WiegandNativeEEPROM();
+
+  void     begin( unsigned int);                            // at least size bytes (as EEPROM.begin on ESP8266 / ESP32)
+  void     resize( unsigned int);                           // set size (content kept, new bytes = 0xFF)
+  bool     commit();                                        // save to file (if set)
+  void     end() { commit(); }
+
+  uint8_t  read( int);
+  void     write( int, uint8_t);
+  void     update( int, uint8_t);
+  uint16_t length();
+
+  template< typename T> T& get( int address, T& t)
+  {
+    for ( size_t i = 0; i < sizeof( T); i++) (( uint8_t*) &t)[ i] = read( address + i);
+    return t;
+  }
+
+  template< typename T> const T& put( int address, const T& t)
+  {
+    for ( size_t i = 0; i < sizeof( T); i++) update( address + i, (( const uint8_t*) &t)[ i]);
+    return t;
+  }
+
+  bool          open( const char*);                         // use file as EEPROM content (false = new file)
+  void          erase();                                    // all bytes 0xFF
+  unsigned long writes();                                   // bytes changed since start (wear)
+  unsigned long reads();                                    // bytes read since start
+
+protected:
+  uint8_t*      _data;
+  unsigned int  _size;
+  const char*   _file;
+  unsigned long _writes;
+  unsigned long _reads;
+};
+
+extern WiegandNativeSerial Serial;
+extern WiegandNativeEEPROM EEPROM;
+
+// test bench side of the simulated hardware
+struct WiegandNative {
+  static void          advance( unsigned long);             // advance simulated time (us)
+  static void          setPin( int, int);                   // drive input pin (attached interrupt fires on matching edge)
+  static void          pulse( int, unsigned int);           // low pulse on input pin (width in us)
+  static void          timer( void (*)(), unsigned long);   // periodic timer interrupt (period in us, 0 = stopped)
+  static void          alarm( void (*)(), unsigned long);   // one shot timer interrupt (delay in us, 0 = cancelled)
+  static void          connect( int, int);                  // output pin drives input pin (output, input, -1 = none)
+  static void          pinChange( byte, byte, void (*)( byte));
+                                                            // enable pin change interrupt (port, pins added to mask, handler( port))
+  static volatile uint8_t& port( byte);                     // input register of port (8 pins per port, bit set = high)
+  static unsigned long edges();                             // interrupts fired since start
+  static void          sleep();                             // MCU asleep: time runs to the next timer / alarm interrupt (at most 1 ms = AVR timer 0 tick)
+  static unsigned long slept();                             // time asleep since start (us)
+  static void          reset();                             // time = 0, all pins high, no interrupts attached / enabled, timer stopped
+
+protected:
+  static void          _interrupt( void (*)(), int = -1);   // fire interrupt (or hold back until interrupts(), port = pin change)
+};
+
+#endif
@@ -0,0 +1,158 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host)
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandReplayTool.cpp
+// Purpose    : Replay of captured edge traces (see WiegandTrace.h) through the decoder on the simulated hardware
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// usage: wgreplay [--poll us] <trace> ...                    decode traces ('-' = stdin), one line per code received
+//
+// output: time (s) since start of trace, then "tag <bits> <code hex> <facility> <card>" or "pin <code>";
+//         a summary (edges, codes, decoder statistics, replay speed) goes to stderr
+// time runs on the simulated clock: idle gaps are skipped, so hours of traffic replay in seconds;
+// diff the output of two library versions to find changes in decoding
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "Wiegand.h"
+#include "WiegandTrace.h"
+
+#define PIN_D0 2                                            // simulated reader lines
+#define PIN_D1 3
+
+#if !WIEGAND_STATS
+#error "build with -D WIEGAND_STATS=1 (summary of rejected frames)"
+#endif
+
+static Wiegand            wg( PIN_D0, PIN_D1);
+static unsigned long long elapsed = 0;                      // simulated time since start of trace (us)
+static unsigned long long idle    = 0;                      // simulated time since last edge (us)
+static unsigned long      codes   = 0;
+
+// host time (ns)
+static unsigned long long now()
+{
+  return std::chrono::duration_cast< std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// print codes available
+static void report()
+{
+  while ( wg.available()) {
+    printf( "%llu.%06llu ", elapsed / 1000000, elapsed % 1000000);
+
+    if ( wg.getType() == WTAG) {
+      printf( "tag %u %llx %lu %llu\n", wg.getBitCount(), ( unsigned long long) wg.getCode64(), wg.getFacilityCode(),
+              ( unsigned long long) wg.getCardNumber());
+    } else {
+      printf( "pin %lu\n", wg.getKeyCode());
+    }
+
+    codes++;
+  }
+}
+
+// advance simulated time, loop polled every poll us until the last frame is surely closed, rest of a gap skipped
+static void wait( unsigned long long us, unsigned long poll)
+{
+  while ( us > 0) {
+    unsigned long step = ( us < poll) ? us : poll;
+
+    if ( idle > 2 * WIEGAND_END_MAX + poll) step = us;      // frame closed and reported = skip to next edge
+
+    WiegandNative::advance( step);
+    elapsed += step;
+    idle    += step;
+    us      -= step;
+
+    report();
+  }
+}
+
+// replay one trace (false = file not found)
+static bool replay( const char* file, unsigned long poll, unsigned long& edges, unsigned long& lost, unsigned long& errors)
+{
+  FILE*              f = strcmp( file, "-") ? fopen( file, "r") : stdin;
+  WiegandTraceReader trace;
+  WiegandEdge        edge;
+  uint32_t           last = 0;
+
+  if ( !f) {
+    perror( file);
+    return false;
+  }
+
+  for ( int c = 0; c >= 0; ) {
+    c = fgetc( f);
+
+    if ( !trace.parse( c, edge)) continue;
+
+    wait(( uint32_t)( edge.time - last), poll);             // gap before edge (polling the loop as a sketch would)
+
+    int pin = edge.line ? PIN_D1 : PIN_D0;
+
+    WiegandNative::setPin( pin, LOW);                       // falling edge = bit (decoder ignores the pulse width)
+    WiegandNative::setPin( pin, HIGH);
+
+    last = edge.time;
+    idle = 0;
+    edges++;
+  }
+
+  wait( 2 * WIEGAND_END_MAX + 2 * poll, poll);              // close last frame
+
+  lost   += trace.getLost();
+  errors += trace.getErrors();
+
+  if ( f != stdin) fclose( f);
+  return true;
+}
+
+int main( int argc, char** argv)
+{
+  unsigned long poll   = 1000;                              // us between calls of available()
+  unsigned long edges  = 0;
+  unsigned long lost   = 0;
+  unsigned long errors = 0;
+  int           files  = 0;
+  bool          ok     = true;
+
+  wg.begin();
+
+  unsigned long long start = now();
+
+  for ( int i = 1; i < argc; i++) {
+    if ( !strcmp( argv[ i], "--poll") && ( i + 1 < argc)) {
+      poll = atol( argv[ ++i]);
+      if ( poll == 0) poll = 1;
+    } else {
+      ok &= replay( argv[ i], poll, edges, lost, errors);
+      files++;
+    }
+  }
+
+  if ( files == 0) {
+    fprintf( stderr, "usage: wgreplay [--poll us] <trace> ...\n");
+    return 2;
+  }
+
+  double       host = ( now() - start) / 1e9;
+  WiegandStats stats;
+
+  wg.getStats( stats);
+
+  unsigned long tags = 0;
+
+  for ( byte i = 0; i < WiegandFormats::count; i++) tags += stats.tags[ i];
+
+  fprintf( stderr, "%lu edges (%lu lost, %lu bad tokens), %lu codes (%lu tag / %lu key frames)\n",
+           edges, lost, errors, codes, tags, stats.keys);
+  fprintf( stderr, "rejected: %lu bit count, %lu length, %lu parity, %lu key nibble; dropped: %lu overrun, %lu repeat\n",
+           stats.badBitCount, stats.badLength, stats.badParity, stats.badKeyNibble, stats.overruns, stats.repeats);
+  fprintf( stderr, "%.1f s traffic in %.3f s (%.0fx real time)\n", elapsed / 1e6, host, host > 0 ? elapsed / 1e6 / host : 0.0);
+
+  return ok ? 0 : 1;
+}
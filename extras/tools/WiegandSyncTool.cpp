@@ -0,0 +1,370 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host)
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandSyncTool.cpp
+// Purpose    : Host side of WiegandSync (import / export of the tag database over a serial port, stream files)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// usage: wgsync import <port> <csv> [--replace] [--baud n]   send tags to a device running WiegandSync
+//        wgsync export <port> [--baud n]                      print tags of a device (csv)
+//        wgsync encode <csv> <file> [--replace] [--records n] write an import stream to a file (other transports)
+//        wgsync decode <file>                                 print the records of a stream file (csv)
+//
+// csv: one record per line, "tag,key" (create / update, key optional), "-tag" (delete), '#' = comment;
+//      numbers are decimal or hex (0x...)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "WiegandSync.h"
+
+#define RETRIES 5                                           // frame sent again (no ACK / NAK)
+
+#if WIEGAND_SYNC_RECORDS < 28
+#error "build with -D WIEGAND_SYNC_RECORDS=28 (receives frames of any device)"
+#endif
+
+// file descriptor (serial port / file) as Stream
+class WiegandFileStream : public Stream {
+public:
+  WiegandFileStream( int fd, int timeout) : _fd( fd), _timeout( timeout), _count( 0), _index( 0) {}
+
+  int available()                                           // waits up to timeout (ms) for the next bytes
+  {
+    if ( _index == _count) {
+      struct pollfd p = { _fd, POLLIN, 0 };
+      ssize_t       n = ( poll( &p, 1, _timeout) > 0) ? ::read( _fd, _buffer, sizeof( _buffer)) : 0;
+
+      _index = 0;
+      _count = ( n > 0) ? n : 0;
+    }
+
+    return _count - _index;
+  }
+
+  int read()
+  {
+    return available() ? _buffer[ _index++] : -1;
+  }
+
+  int peek()
+  {
+    return available() ? _buffer[ _index] : -1;
+  }
+
+  size_t write( uint8_t value)
+  {
+    return ::write( _fd, &value, 1) == 1;
+  }
+
+  size_t write( const uint8_t* buffer, size_t size)
+  {
+    return ::write( _fd, buffer, size) == ( ssize_t) size ? size : 0;
+  }
+
+protected:
+  int     _fd;
+  int     _timeout;                                         // ms (0 = files)
+  uint8_t _buffer[ 256];
+  int     _count;
+  int     _index;
+};
+
+struct Record {
+  byte     op;
+  uint32_t tag;
+  uint32_t key;
+};
+
+static Record* records = 0;
+static long    count   = 0;
+
+// read csv (false = syntax error)
+static bool load( const char* file)
+{
+  FILE* f = strcmp( file, "-") ? fopen( file, "r") : stdin;
+  char  line[ 128];
+  long  size = 0;
+  long  number = 0;
+
+  if ( !f) {
+    perror( file);
+    return false;
+  }
+
+  while ( fgets( line, sizeof( line), f)) {
+    char* p = line;
+
+    number++;
+    while (( *p == ' ') || ( *p == '\t')) p++;
+    if (( *p == '#') || ( *p == '\n') || ( *p == '\r') || ( *p == 0)) continue;
+
+    if ( count == size) records = ( Record*) realloc( records, ( size = size ? 2 * size : 1024) * sizeof( Record));
+
+    Record& r = records[ count];
+    char*   end;
+
+    r.op  = ( *p == '-') ? WGSYNC_DELETE : WGSYNC_UPSERT;
+    r.tag = strtoul( p + ( *p == '-'), &end, 0);
+    r.key = 0;
+
+    if ( *end == ',') r.key = strtoul( end + 1, &end, 0);
+
+    if (( end == p) || ( r.tag == 0)) {
+      fprintf( stderr, "%s:%ld: bad record\n", file, number);
+      return false;
+    }
+
+    count++;
+  }
+
+  if ( f != stdin) fclose( f);
+  return true;
+}
+
+// payload of DATA frame for records first .. first + n - 1
+static byte pack( byte* payload, byte sequence, long first, int n)
+{
+  payload[ 0] = sequence;
+
+  for ( int i = 0; i < n; i++) {
+    WiegandSyncLink::putRecord( payload + 1 + i * WGSYNC_RECORD, records[ first + i].op, records[ first + i].tag, records[ first + i].key);
+  }
+
+  return 1 + n * WGSYNC_RECORD;
+}
+
+// print records of DATA frame (csv)
+static void unpack( const byte* payload, byte length)
+{
+  for ( int i = 1; i + WGSYNC_RECORD <= length; i += WGSYNC_RECORD) {
+    uint32_t tag, key;
+
+    if ( WiegandSyncLink::getRecord( payload + i, tag, key) == WGSYNC_DELETE) {
+      printf( "-%lu\n", ( unsigned long) tag);
+    } else {
+      printf( "%lu,%lu\n", ( unsigned long) tag, ( unsigned long) key);
+    }
+  }
+}
+
+// open serial port (raw, 8N1)
+static int openPort( const char* port, long baud)
+{
+  static const long   rates[]  = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
+  static const speed_t speeds[] = { B9600, B19200, B38400, B57600, B115200, B230400, B460800, B921600 };
+
+  int fd = open( port, O_RDWR | O_NOCTTY);
+
+  if ( fd < 0) {
+    perror( port);
+    return -1;
+  }
+
+  struct termios tty;
+
+  if ( tcgetattr( fd, &tty) == 0) {                         // tty (a pipe / socket is used as is)
+    speed_t speed = B115200;
+
+    for ( int i = 0; i < 8; i++) if ( rates[ i] == baud) speed = speeds[ i];
+
+    cfmakeraw( &tty);
+    cfsetispeed( &tty, speed);
+    cfsetospeed( &tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tcsetattr( fd, TCSANOW, &tty);
+
+    sleep( 2);                                              // board resets when the port is opened
+    tcflush( fd, TCIOFLUSH);
+  }
+
+  return fd;
+}
+
+// send frame and wait for its ACK (returns ACK status, -1 = no answer)
+static int request( WiegandSyncLink& link, byte type, const byte* payload, byte length, byte sequence, const byte** ack)
+{
+  for ( int retry = 0; retry < RETRIES; retry++) {
+    link.send( type, payload, length);
+
+    while ( link.receive()) {                               // skip answers of earlier frames
+      const byte* p = link.getPayload();
+
+      if (( link.getStatus() == WGSYNC_OK) && ( link.getType() == WGSYNC_ACK) && ( link.getLength() >= 6) &&
+          ( p[ 0] == type) && ( p[ 1] == sequence)) {
+        if ( p[ 2] == WGSYNC_BAD_CRC) break;                // damaged on the way = send again
+
+        *ack = p;
+        return p[ 2];
+      }
+    }
+  }
+
+  return -1;
+}
+
+static int importTags( const char* port, long baud, bool replace)
+{
+  int fd = openPort( port, baud);
+
+  if ( fd < 0) return 1;
+
+  WiegandFileStream stream( fd, 1000);
+  WiegandSyncLink   link( stream);
+  const byte*       ack;
+  byte              flags = replace ? WGSYNC_REPLACE : 0;
+
+  if ( request( link, WGSYNC_HELLO, &flags, 1, 0, &ack) != WGSYNC_OK) {
+    fprintf( stderr, "%s: no answer\n", port);
+    return 1;
+  }
+
+  int  perFrame = ack[ 3];                                  // device frame buffer
+  long capacity = ack[ 4] | ( ack[ 5] << 8);
+  byte payload[ 255];
+  byte sequence = 0;
+
+  if ( perFrame * WGSYNC_RECORD + 1 > ( int) sizeof( payload)) perFrame = ( sizeof( payload) - 1) / WGSYNC_RECORD;
+
+  fprintf( stderr, "%s: %ld records, device capacity %ld, %d records per frame\n", port, count, capacity, perFrame);
+
+  for ( long i = 0; i < count; i += perFrame, sequence++) {
+    int  n      = ( count - i < perFrame) ? count - i : perFrame;
+    int  status = request( link, WGSYNC_DATA, payload, pack( payload, sequence, i, n), sequence, &ack);
+
+    if ( status != WGSYNC_OK) {
+      fprintf( stderr, "%s: record %ld: %s\n", port, i + 1,
+               status == WGSYNC_FULL ? "tag table full" : ( status < 0 ? "no answer" : "rejected"));
+      return 1;
+    }
+  }
+
+  request( link, WGSYNC_END, 0, 0, 0, &ack);
+  close( fd);
+
+  fprintf( stderr, "%s: %ld records imported (%u frames sent again)\n", port, count, link.getErrors());
+  return 0;
+}
+
+static int exportTags( const char* port, long baud)
+{
+  int fd = openPort( port, baud);
+
+  if ( fd < 0) return 1;
+
+  WiegandFileStream stream( fd, 2000);
+  WiegandSyncLink   link( stream);
+  long              received = 0;
+
+  link.send( WGSYNC_EXPORT, 0, 0);
+
+  while ( link.receive()) {
+    const byte* p = link.getPayload();
+
+    if ( link.getStatus() != WGSYNC_OK) {
+      fprintf( stderr, "%s: damaged frame, export again\n", port);
+      return 1;
+    }
+
+    if ( link.getType() == WGSYNC_DATA) {
+      unpack( p, link.getLength());
+      received += link.getLength() / WGSYNC_RECORD;
+    }
+
+    if ( link.getType() == WGSYNC_END) {
+      long sent = p[ 0] | ( p[ 1] << 8) | (( long) p[ 2] << 16) | (( long) p[ 3] << 24);
+
+      close( fd);
+      fprintf( stderr, "%s: %ld records exported\n", port, received);
+      return ( sent == received) ? 0 : 1;
+    }
+  }
+
+  fprintf( stderr, "%s: no answer\n", port);
+  return 1;
+}
+
+static int encode( const char* file, bool replace, int perFrame)
+{
+  FILE* f = fopen( file, "wb");
+
+  if ( !f) {
+    perror( file);
+    return 1;
+  }
+
+  WiegandFileStream stream( fileno( f), 0);
+  WiegandSyncLink   link( stream);
+  byte              payload[ 255];
+  byte              flags    = replace ? WGSYNC_REPLACE : 0;
+  byte              sequence = 0;
+
+  link.send( WGSYNC_HELLO, &flags, 1);
+
+  for ( long i = 0; i < count; i += perFrame) {
+    int n = ( count - i < perFrame) ? count - i : perFrame;
+
+    link.send( WGSYNC_DATA, payload, pack( payload, sequence++, i, n));
+  }
+
+  link.send( WGSYNC_END, 0, 0);
+  fclose( f);
+  return 0;
+}
+
+static int decode( const char* file)
+{
+  int fd = strcmp( file, "-") ? open( file, O_RDONLY) : 0;
+
+  if ( fd < 0) {
+    perror( file);
+    return 1;
+  }
+
+  WiegandFileStream stream( fd, 0);
+  WiegandSyncLink   link( stream);
+
+  while ( link.receive()) {
+    if ( link.getStatus() != WGSYNC_OK) continue;           // counted as error
+
+    if ( link.getType() == WGSYNC_DATA) unpack( link.getPayload(), link.getLength());
+  }
+
+  if ( link.getErrors()) fprintf( stderr, "%s: %u damaged frames\n", file, link.getErrors());
+  return link.getErrors() ? 1 : 0;
+}
+
+int main( int argc, char** argv)
+{
+  bool replace  = false;
+  long baud     = 115200;
+  int  perFrame = 8;                                        // library default of WIEGAND_SYNC_RECORDS (device frame buffer)
+  int  n        = 0;
+  const char* args[ 3] = { 0, 0, 0 };
+
+  for ( int i = 1; i < argc; i++) {
+    if      ( !strcmp( argv[ i], "--replace"))                    replace  = true;
+    else if ( !strcmp( argv[ i], "--baud")    && ( i + 1 < argc)) baud     = atol( argv[ ++i]);
+    else if ( !strcmp( argv[ i], "--records") && ( i + 1 < argc)) perFrame = atoi( argv[ ++i]);
+    else if ( n < 3)                                              args[ n++] = argv[ i];
+  }
+
+  if ( perFrame < 1)   perFrame = 1;
+  if ( perFrame > 28)  perFrame = 28;                       // payload <= 255 bytes
+
+  if (( n == 3) && !strcmp( args[ 0], "import")) return load( args[ 2]) ? importTags( args[ 1], baud, replace) : 1;
+  if (( n == 2) && !strcmp( args[ 0], "export")) return exportTags( args[ 1], baud);
+  if (( n == 3) && !strcmp( args[ 0], "encode")) return load( args[ 1]) ? encode( args[ 2], replace, perFrame) : 1;
+  if (( n == 2) && !strcmp( args[ 0], "decode")) return decode( args[ 1]);
+
+  fprintf( stderr, "usage: wgsync import <port> <csv> [--replace] [--baud n]\n"
+                   "       wgsync export <port> [--baud n]\n"
+                   "       wgsync encode <csv> <file> [--replace] [--records n]\n"
+                   "       wgsync decode <file>\n");
+  return 2;
+}
@@ -6,41 +6,141 @@
 // Purpose    : Receiving IDs from a Wiegand compatible device (reader / keypad)
 // Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
 
-#include <Arduino.h>
+#include "WiegandPlatform.h"
 #include "Wiegand.h"
-#include "SimpleUtils.h"
+
+#if WIEGAND_TIMER
+#if defined( ARDUINO_ARCH_AVR)
+#include <TimerOne.h>                                       // timer 1 interrupt
+#elif defined( ESP8266) || defined( ESP32)
+#include <Ticker.h>                                         // timer task (no ISR)
+static Ticker WiegandTicker;
+#elif defined( ARDUINO)
+#error "WIEGAND_TIMER is not supported on this platform"
+#endif
+#endif
+
+#if defined( ARDUINO_ARCH_AVR)
+#include <avr/sleep.h>                                      // idle()
+#endif
 
 #define NO_WIEGAND_DEBUG                                    // use WIEGAND_DEBUG for debug info
 
-#define WIEGAND_BITCOUNT_WAIT   25                          // max ticks between bits recevied
-#define WIEGAND_KEYPRESS_WAIT  200                          // max ticks between keys recevied
+static const char WGTypeNone[] PROGMEM = "--N/A--";         // type labels in flash (no RAM used on AVR)
+static const char WGTypeTag[]  PROGMEM = "W26/W34";
+static const char WGTypeKey[]  PROGMEM = "W04/W08";
+
+const char* const WGTypeLabel_P[3] PROGMEM = { WGTypeNone, WGTypeTag, WGTypeKey};
+const char*       WGTypeLabel[3] = { "--N/A--", "W26/W34", "W04/W08"};
+                                                            // RAM copy (deprecated, dropped by the linker when unused)
 
-const char* WGTypeLabel[3] = { "--N/A--", "W26/W34", "W04/W08"};
+Wiegand* Wiegand::_readers[ WIEGAND_MAX_READERS];           // active readers (indexed by reader index)
+byte     Wiegand::_readerCount = 0;                         // number of readers started
 
-volatile unsigned long  Wiegand::_tick     = 0;             // system time of last received bit
-volatile unsigned long  Wiegand::_data     = 0;             // full bit stream of received bits
-volatile int            Wiegand::_bitCount = 0;             // number of bits received
+#if WIEGAND_TIMER
+volatile bool Wiegand::_dispatching = false;                // timer context not decoding
+#endif
+
+#if WIEGAND_PCINT
+byte Wiegand::_pcintLast[ WIEGAND_PIN_GROUPS];              // port value at previous pin change (per port)
+byte Wiegand::_pcintLine[ WIEGAND_PIN_GROUPS][ 8];          // reader / line of port bit (reader * 2 + line + 1, 0 = none)
+#endif
 
 // initializes the Wiegand device connection (line D0 / D1)
 Wiegand::Wiegand( int pinD0, int pinD1)
 {
-  _clrDataBuffer();                                             // prepare data buffer
+  _clrDataBuffer();                                         // prepare data buffer
 
   pinMode( _pinD0 = pinD0, INPUT);                          // Set pin used for line D0 as input
   pinMode( _pinD1 = pinD1, INPUT);                          // Set pin used for line D1 as input
 
   _code = 0;                                                // clear code buffer
+  _code64 = 0;
+  _facility = 0;
+  _card = 0;
+  _frame.bitCount = 0;                                      // no frame received (yet)
   _type = 0;                                                // clear type (= bitcount)
   _available = false;                                       // false = no code available (yet)
+
+  _keyData  = 0;                                            // clear key entry
+  _keyTime  = 0;
+  _reader   = WIEGAND_MAX_READERS;                          // no reader index assigned (yet)
+  _head     = 0;                                            // empty frame queue
+  _tail     = 0;
+  _overflow = 0;
+  _repeats  = 0;
+  _lastTick = 0;
+
+  for ( byte i = 0; i < WIEGAND_QUEUE_SIZE; i++) _queue[ i].bitCount = 0;
+                                                            // no previous frame (repeat check)
+  setRepeatWindow( WIEGAND_REPEAT_WINDOW, WIEGAND_KEY_DEBOUNCE);
+  setKeyTimeout( WIEGAND_KEY_TIMEOUT);
+
+  #if WIEGAND_TIMER
+  _onTag     = 0;                                           // no callbacks (yet)
+  _onPin     = 0;
+  _delivered = false;
+  #endif
+
+  _interval = 0;                                            // bit interval not known (yet)
+  _timeout  = WIEGAND_END_MAX;
+
+  #if WIEGAND_STATS
+  clearStats();                                             // no statistics (yet)
+  #endif
+
+  #if WIEGAND_CAPTURE
+  _edgeHead    = 0;                                         // no edges captured (yet)
+  _edgeTail    = 0;
+  _edgesLost   = 0;
+  _edgesTraced = 0;
+  #endif
 }
 
 // initializes the Wiegand device connection (line D0 / D1)
 void Wiegand::begin()
 {
+  if ( _reader < WIEGAND_MAX_READERS) return;               // already started
+  if ( _readerCount >= WIEGAND_MAX_READERS) return;         // no ISR pair left (raise WIEGAND_MAX_READERS)
+
+  #if WIEGAND_PCINT
+  _groupD0 = wgPinGroup( _pinD0);                           // port / bit of lines (resolved once)
+  _maskD0  = wgPinMask ( _pinD0);
+  _groupD1 = wgPinGroup( _pinD1);
+  _maskD1  = wgPinMask ( _pinD1);
+
+  if (( _groupD0 == WIEGAND_NOGROUP) || ( _groupD1 == WIEGAND_NOGROUP)) return;
+                                                            // pin without pin change interrupt
+  if ( !( WIEGAND_PCINT_GROUPS & ( 1 << _groupD0)) || !( WIEGAND_PCINT_GROUPS & ( 1 << _groupD1))) return;
+                                                            // port excluded by WIEGAND_PCINT_GROUPS (both lines checked first = no PCMSK bit set)
+  noInterrupts();                                           // disable interupts while enabling
+  _readers[ _reader = _readerCount++] = this;               // claim next reader index
+
+  _enablePCINT( _groupD0, _maskD0);
+  _enablePCINT( _groupD1, _maskD1);
+                                                            // edge dispatch table (ISR cost independent of reader count)
+  _pcintLine[ _groupD0][ wgPinBit( _maskD0)] = _reader * 2 + 0x00 + 1;
+  _pcintLine[ _groupD1][ wgPinBit( _maskD1)] = _reader * 2 + 0x01 + 1;
+  interrupts();                                             // pin change interrupt = any edge on port (falling edges used)
+  #else
   noInterrupts();                                           // disable interupts while attaching
-  attachInterrupt( digitalPinToInterrupt( _pinD0), _pulseD0, FALLING);
-  attachInterrupt( digitalPinToInterrupt( _pinD1), _pulseD1, FALLING);
+  _readers[ _reader = _readerCount++] = this;               // claim next ISR pair
+  _attachISR< WIEGAND_MAX_READERS - 1>( _reader, _pinD0, _pinD1);
   interrupts();                                             // hardware interrupt = high to low pulse on line D0/D1
+  #endif
+
+  #if WIEGAND_TIMER
+  if ( _reader == 0) {                                      // one timer for all readers
+    #if defined( ARDUINO_ARCH_AVR)
+    Timer1.initialize( WIEGAND_TIMER_PERIOD);
+    Timer1.attachInterrupt( _timerISR);
+    #elif defined( ESP8266) || defined( ESP32)
+    WiegandTicker.attach_ms(( WIEGAND_TIMER_PERIOD + 999) / 1000, _timerISR);
+    #else
+    WiegandNative::timer( _timerISR, WIEGAND_TIMER_PERIOD);
+    #endif
+  }
+  #endif
 }
 
 // reset active tag / key values
@@ -52,12 +152,29 @@ void Wiegand::reset()
 // checks is a Wiegand device is connected to pinD0 / pinD1
 bool Wiegand::hasDevice()
 {                                                           // return true = Wiegand device connected
+  #if WIEGAND_PCINT
+  if ( _reader < WIEGAND_MAX_READERS) {                     // direct port reads (masks known after begin)
+    return ( wgGroupInput( _groupD0) & _maskD0) && ( wgGroupInput( _groupD1) & _maskD1);
+  }
+  #endif
+
   return ( digitalRead( _pinD0) == HIGH) && ( digitalRead( _pinD1) == HIGH);
 }
 
 // checks if a new Wiegand ID has been received
 bool Wiegand::available()
 {
+  #if WIEGAND_TIMER
+  if ( _onTag || _onPin) {                                  // frames decoded by timer context
+    noInterrupts();
+    bool delivered = _delivered;
+    _delivered = false;
+    interrupts();
+
+    return delivered;                                       // true = code delivered since last call
+  }
+  #endif
+
   return _dataIsAvailable();                                // call internal handler
 }
 
@@ -70,12 +187,18 @@ unsigned long Wiegand::getCode()
 // returns the last active Wiegand type
 WiegandType Wiegand::getType()
 {
-  if (( _type == 26) || ( _type == 34)) return WTAG;        // code received via reader
   if (( _type ==  4) || ( _type ==  8)) return WKEY;        // code received via keypad
+  if (  _type >= 26)                     return WTAG;       // code received via reader
 
   return NONE;
 }
 
+// returns the label of the last active Wiegand type (e.g. Serial.print( wg.getTypeLabel()))
+const __FlashStringHelper* Wiegand::getTypeLabel()
+{
+  return ( const __FlashStringHelper*) pgm_read_ptr( &WGTypeLabel_P[ getType()]);
+}
+
 // returns the last active Wiegand code
 unsigned long Wiegand::getTagCode()
 {
@@ -88,6 +211,294 @@ unsigned long Wiegand::getKeyCode()
   return _keyCode;                                          // return last key code (as entered via key pad)
 }
 
+// returns the last active Wiegand code (up to 64 bits)
+uint64_t Wiegand::getCode64()
+{
+  return _code64;                                           // parity bits removed for known formats
+}
+
+// returns the facility code of the last active tag
+unsigned long Wiegand::getFacilityCode()
+{
+  return _facility;                                         // 0 = format without facility code
+}
+
+// returns the card number of the last active tag
+uint64_t Wiegand::getCardNumber()
+{
+  return _card;                                             // card number field of format
+}
+
+// returns the bit count of the last active frame
+byte Wiegand::getBitCount()
+{
+  return _frame.bitCount;                                   // bit count (0 = no frame received)
+}
+
+// copies the last active frame to buffer (size in bytes, first bit = hi bit of buffer[0])
+byte Wiegand::getRawData( byte* buffer, byte size)
+{
+  byte bytes = ( _frame.bitCount + 7) / 8;                  // bytes used by last frame
+
+  if ( size > bytes) size = bytes;
+  memcpy( buffer, _frame.data, size);                       // copy (part of) the frame
+
+  return _frame.bitCount;                                   // return full bit count
+}
+
+// returns the learned bit interval of the reader (us)
+unsigned long Wiegand::getBitInterval()
+{
+  return _interval;                                         // 0 = no frame received (yet)
+}
+
+// returns number of frames dropped on a full queue
+unsigned int Wiegand::getOverflowCount()
+{
+  return _overflow;                                         // frames dropped since start
+}
+
+// returns number of repeated frames dropped
+unsigned int Wiegand::getRepeatCount()
+{
+  return _repeats;                                          // frames dropped since start
+}
+
+// drop frames equal to the previous frame of the reader within window (tag ms, key ms, 0 = off); window restarts with each repeat
+void Wiegand::setRepeatWindow( unsigned int tag, unsigned int key)
+{
+  noInterrupts();                                           // windows used by ISR
+  _repeatTag = tag * 1000UL;                                // us (no multiplication in ISR)
+  _repeatKey = key * 1000UL;
+  interrupts();
+}
+
+// discard digits entered longer ago than timeout (ms, 0 = kept until '#' / '*')
+void Wiegand::setKeyTimeout( unsigned long timeout)
+{
+  _keyTimeout = timeout;
+}
+
+// sleep until a frame of any reader is complete (true = call available()) or ms elapsed (false, 0 = no limit);
+// each edge wakes the MCU (ISR stores the bit), the end of a frame is found on the next timer wake-up (as in a polling loop)
+bool Wiegand::idle( unsigned long ms)
+{
+  unsigned long start = millis();
+
+  for (;;) {
+    bool receiving = false;                                 // frame in progress = timer needed (bit gaps / end of frame)
+
+    noInterrupts();                                         // edge between check and sleep = wakes at once
+
+    for ( byte i = 0; i < _readerCount; i++) {
+      Wiegand* reader = _readers[ i];
+
+      reader->_endFrame();                                  // end of frame timeout elapsed = close frame
+
+      #if WIEGAND_TIMER
+      bool ready = ( reader->_onTag || reader->_onPin) ? reader->_delivered : ( reader->_head != reader->_tail); // callbacks = queue drained by timer
+      #else
+      bool ready = ( reader->_head != reader->_tail);
+      #endif
+
+      if ( ready) {
+        interrupts();
+        return true;                                        // frame ready for available()
+      }
+
+      if ( reader->_bitCount > 0) receiving = true;
+    }
+
+    if ( ms && (( millis() - start) >= ms)) {
+      interrupts();
+      return false;
+    }
+
+    _sleep( !receiving && !ms);                             // returns with interrupts enabled
+  }
+}
+
+#if WIEGAND_TIMER
+// sets callback for tags received (called from timer context)
+void Wiegand::onTag( WiegandTagCallback callback)
+{
+  _onTag = callback;
+}
+
+// sets callback for PINs entered (called from timer context)
+void Wiegand::onPin( WiegandPinCallback callback)
+{
+  _onPin = callback;
+}
+
+// <internal function:> timer interrupt: close completed frames, then decode them with interrupts enabled
+void Wiegand::_timerISR()
+{
+  #if defined( ARDUINO_ARCH_AVR)
+  for ( byte i = 0; i < _readerCount; i++) _readers[ i]->_endFrame();
+                                                            // in ISR = interrupts blocked
+  if ( _dispatching) return;                                // previous timer interrupt still decoding
+
+  _dispatching = true;
+  interrupts();                                             // deferred part (Wiegand pulses keep coming in)
+  #else
+  noInterrupts();                                           // timer task = block pulses while closing
+  for ( byte i = 0; i < _readerCount; i++) _readers[ i]->_endFrame();
+  interrupts();
+
+  if ( _dispatching) return;
+
+  _dispatching = true;
+  #endif
+
+  for ( byte i = 0; i < _readerCount; i++) {
+    Wiegand* reader = _readers[ i];
+
+    if ( reader->_onTag || reader->_onPin) {                // polling readers decode in available()
+      while ( reader->_dataIsAvailable()) reader->_dispatch();
+    }
+  }
+
+  #if defined( ARDUINO_ARCH_AVR)
+  noInterrupts();                                           // leave ISR as entered
+  #endif
+  _dispatching = false;
+}
+
+// <internal function:> call callback for last code
+void Wiegand::_dispatch()
+{
+  _delivered = true;                                        // seen by available()
+
+  if ( getType() == WTAG) {
+    if ( _onTag) _onTag( _code64, _frame.bitCount);
+  } else {
+    if ( _onPin) _onPin( _keyCode);
+  }
+}
+#endif
+
+#if WIEGAND_STATS
+// copies the decoder statistics
+void Wiegand::getStats( WiegandStats& stats)
+{
+  noInterrupts();                                           // consistent copy (counters updated by ISR)
+  for ( unsigned int i = 0; i < sizeof( WiegandStats); i++) {
+    (( byte*) &stats)[ i] = (( volatile byte*) &_stats)[ i];
+  }
+  interrupts();
+}
+
+// resets the decoder statistics
+void Wiegand::clearStats()
+{
+  noInterrupts();
+  for ( unsigned int i = 0; i < sizeof( WiegandStats); i++) {
+    (( volatile byte*) &_stats)[ i] = 0;
+  }
+  interrupts();
+}
+
+// <internal function:> histogram bucket of value (0 = 0, n = 2^(n-1) .. 2^n - 1)
+byte Wiegand::_bucket( unsigned long value)
+{
+  byte bucket = 0;
+
+  while ( value && ( bucket < WIEGAND_STATS_BUCKETS - 1)) {
+    value >>= 1;
+    bucket++;
+  }
+
+  return bucket;
+}
+#endif
+
+#if WIEGAND_CAPTURE
+// removes the oldest captured edge (false = none captured)
+bool Wiegand::readEdge( WiegandEdge& edge)
+{
+  noInterrupts();                                           // tail moved by ISR when ring full
+  bool     found = ( _edgeTail != _edgeHead);
+  uint32_t value = _edges[ _edgeTail];
+
+  if ( found) _edgeTail = ( _edgeTail + 1) & ( WIEGAND_CAPTURE - 1);
+  interrupts();
+
+  edge.time = value & ~1UL;
+  edge.line = value & 0x01;
+
+  return found;
+}
+
+// returns number of edges captured (not yet read)
+unsigned int Wiegand::getEdgeCount()
+{
+  noInterrupts();
+  unsigned int count = ( _edgeHead - _edgeTail) & ( WIEGAND_CAPTURE - 1);
+  interrupts();
+
+  return count;
+}
+
+// returns number of edges overwritten before read (ring full)
+unsigned long Wiegand::getEdgesLost()
+{
+  noInterrupts();
+  unsigned long lost = _edgesLost;
+  interrupts();
+
+  return lost;
+}
+
+// writes captured edges as trace, e.g. to Serial (returns edges written)
+unsigned int Wiegand::dumpTrace( WiegandTraceWriter& trace)
+{
+  WiegandEdge  edge;
+  unsigned int count = 0;
+
+  unsigned long lost = getEdgesLost();
+
+  trace.lost( lost - _edgesTraced);                         // overrun since last dump (gap in trace)
+  _edgesTraced = lost;
+
+  while ( readEdge( edge)) {
+    trace.write( edge);
+    count++;
+  }
+
+  return count;
+}
+#endif
+
+// <internal function:> sleep until next interrupt (called with interrupts blocked, returns with interrupts enabled);
+// AVR = idle mode (timer 0 / INT0 / INT1 edges need the I/O clock), standby with pin change interrupts and no timer needed
+// (PCINT wakes asynchronously, oscillator kept running = wake-up within 6 cycles, millis() paused); ESP = delay (idle task)
+void Wiegand::_sleep( bool deep)
+{
+  #if defined( ARDUINO_ARCH_AVR)
+  byte adc = ADCSRA;
+
+  ADCSRA = 0;                                               // ADC off while asleep
+  set_sleep_mode(( deep && WIEGAND_PCINT) ? SLEEP_MODE_STANDBY : SLEEP_MODE_IDLE);
+  sleep_enable();
+  sei();                                                    // sleep follows sei = pending interrupt wakes at once
+  sleep_cpu();
+  sleep_disable();
+  ADCSRA = adc;
+  #elif defined( ESP8266) || defined( ESP32)
+  ( void) deep;
+  interrupts();
+  delay( 1);                                                // CPU halted in idle task until next interrupt / tick
+  #elif !defined( ARDUINO)
+  ( void) deep;
+  interrupts();
+  WiegandNative::sleep();
+  #else
+  ( void) deep;
+  interrupts();                                             // no sleep support = busy wait
+  #endif
+}
+
 // initialize last tag / key value
 void Wiegand::_clrCodeValues()
 {
@@ -98,102 +509,358 @@ void Wiegand::_clrCodeValues()
 // <internal function:> resets read buffer
 void Wiegand::_clrDataBuffer()
 {
-  _tick     = millis();                                     // reset stopwatch
-  _data     = 0;                                            // reset buffer
+  _tick     = micros();                                     // reset stopwatch
   _bitCount = 0;                                            // reset counter
 }
 
-// <internal function:> process '0' bits coming on line D0
-void Wiegand::_pulseD0()
+// <internal function:> process '0' bits coming on line D0 (ISR trampoline for reader N)
+template< byte N> void Wiegand::_pulseD0()
 {
   #ifdef WIEGAND_DEBUG
-  Serial.print( "0");                                       // bitstream debuf
+  Serial.print( '0');                                       // bitstream debuf
   #endif
 
-  _writeDx( 0x00);                                          // next bit = 0
+  _readers[ N]->_writeDx( 0x00);                            // next bit = 0
 }
 
-// <internal function:> process '1' bits coming on line D1
-void Wiegand::_pulseD1()
+// <internal function:> process '1' bits coming on line D1 (ISR trampoline for reader N)
+template< byte N> void Wiegand::_pulseD1()
 {
   #ifdef WIEGAND_DEBUG
-  Serial.print( "1");                                       // bitstream debuf
+  Serial.print( '1');                                       // bitstream debuf
   #endif
 
-  _writeDx( 0x01);                                          // next bit = 1
+  _readers[ N]->_writeDx( 0x01);                            // next bit = 1
+}
+
+// <internal function:> attach ISR pair 0 (end of compile time recursion)
+template<> void Wiegand::_attachISR< 0>( byte, int pinD0, int pinD1)
+{
+  attachInterrupt( digitalPinToInterrupt( pinD0), _pulseD0< 0>, FALLING);
+  attachInterrupt( digitalPinToInterrupt( pinD1), _pulseD1< 0>, FALLING);
+}
+
+// <internal function:> attach ISR pair of reader index (only WIEGAND_MAX_READERS pairs are instantiated)
+template< byte N> void Wiegand::_attachISR( byte reader, int pinD0, int pinD1)
+{
+  if ( reader == N) {
+    attachInterrupt( digitalPinToInterrupt( pinD0), _pulseD0< N>, FALLING);
+    attachInterrupt( digitalPinToInterrupt( pinD1), _pulseD1< N>, FALLING);
+  } else {
+    _attachISR< N - 1>( reader, pinD0, pinD1);              // try next lower reader index
+  }
+}
+
+#if WIEGAND_PCINT
+// <internal function:> enable pin change interrupt of pins (port in WIEGAND_PCINT_GROUPS)
+void Wiegand::_enablePCINT( byte group, byte mask)
+{
+  _pcintLast[ group] = wgGroupInput( group);                // pins high = no falling edge yet
+
+  #if defined( ARDUINO)
+  wgGroupMask( group) |= mask;                              // pins of port causing an interrupt
+  PCIFR = 1 << group;                                       // clear pending interrupt
+  PCICR |= 1 << group;                                      // enable PCINT vector of port
+  #else
+  WiegandNative::pinChange( group, mask, _pulsePCINT);
+  #endif
+}
+
+// <internal function:> process falling edges of port (one PCINT vector serves all readers on the port)
+void Wiegand::_pulsePCINT( byte group)
+{
+  byte port = wgGroupInput( group);                         // one port read for all lines
+  byte fell = _pcintLast[ group] & ~port;                   // high to low since previous change
+
+  _pcintLast[ group] = port;
+
+  const byte* line = _pcintLine[ group];
+
+  for ( ; fell; fell >>= 1, line++) {                       // falling lines only (none left = done)
+    if (( fell & 0x01) && *line) _readers[( *line - 1) >> 1]->_writeDx(( *line - 1) & 0x01);
+  }
 }
 
+#if defined( ARDUINO)
+#if ( WIEGAND_PCINT_GROUPS & 0x01)
+ISR( PCINT0_vect) { Wiegand::_pulsePCINT( 0); }             // group = constant (port register resolved at compile time)
+#endif
+#if ( WIEGAND_PCINT_GROUPS & 0x02) && ( WIEGAND_PIN_GROUPS > 1)
+ISR( PCINT1_vect) { Wiegand::_pulsePCINT( 1); }
+#endif
+#if ( WIEGAND_PCINT_GROUPS & 0x04) && ( WIEGAND_PIN_GROUPS > 2)
+ISR( PCINT2_vect) { Wiegand::_pulsePCINT( 2); }
+#endif
+#endif
+#endif
+
 // <internal function:> store received bits in buffer
 void Wiegand::_writeDx( byte bit)
 {
-  _tick = millis();                                         // keep ticks between bits received
-  _bitCount++;
+  unsigned long tick = micros();                            // look at stopwatch (us)
+
+  #if WIEGAND_CAPTURE
+  unsigned int next = ( _edgeHead + 1) & ( WIEGAND_CAPTURE - 1);
+
+  if ( next == _edgeTail) {                                 // ring full = oldest edge overwritten (latest edges kept)
+    _edgeTail = ( _edgeTail + 1) & ( WIEGAND_CAPTURE - 1);
+    _edgesLost++;
+  }
+
+  _edges[ _edgeHead] = (( uint32_t) tick & ~1UL) | bit;     // raw edge before decoding
+  _edgeHead = next;
+  #endif
+
+  if ( _bitCount > 0) {
+    unsigned long gap = tick - _tick;                       // time since previous bit
+
+    if ( gap > _timeout) {
+      #if WIEGAND_STATS
+      _stats.timeouts++;                                    // loop did not close frame in time
+      #endif
+
+      if ( _bitCount < 4) {                                 // too short for any format = timeout too short (or noise)
+        _interval = 0;                                      // learn bit interval again
+        _timeout  = WIEGAND_END_MAX;
+      }
+
+      _closeFrame();                                        // elapsed = previous frame complete
+    } else {
+      _learnInterval( gap);                                 // bit interval of this reader
+    }
+  }
+
+  _tick = tick;                                             // keep ticks between bits received
+
+  byte count = _bitCount;                                   // bits received so far (= position of new bit)
+
+  if ( count < WIEGAND_MAX_BITS) {                          // store bit (O(1), no shifting)
+    volatile byte* data = &_queue[ _head].data[ count >> 3];
+    byte           mask = 0x80 >> ( count & 0x07);          // bits are stored hi bit first
+
+    if ( mask == 0x80) {
+      *data = bit ? 0x80 : 0x00;                            // first bit of a new byte = clear rest of byte
+    } else if ( bit) {
+      *data |= mask;                                        // add new bit
+    }
+  }
+
+  if ( count < 0xFF) _bitCount = count + 1;                 // keep counting (too long = rejected later)
+
+  #if WIEGAND_STATS
+  _stats.isrTime[ _bucket( micros() - tick)]++;             // ISR duration
+  #endif
+}
+
+// <internal function:> adapt bit interval to gap between two bits of a frame, end of frame = WIEGAND_END_FACTOR intervals
+void Wiegand::_learnInterval( unsigned long gap)
+{
+  if ( _interval == 0) {
+    _interval = gap;                                        // first gap measured
+  } else {
+    _interval = _interval - ( _interval >> 3) + ( gap >> 3);// moving average (1/8 weight per gap)
+  }
+
+  unsigned long timeout = _interval * WIEGAND_END_FACTOR;
+
+  if ( timeout < WIEGAND_END_MIN) timeout = WIEGAND_END_MIN;
+  if ( timeout > WIEGAND_END_MAX) timeout = WIEGAND_END_MAX;
+
+  _timeout = timeout;
+}
+
+// <internal function:> move received bits to the frame queue (called with interrupts blocked)
+void Wiegand::_closeFrame()
+{
+  byte next = ( _head + 1) & ( WIEGAND_QUEUE_SIZE - 1);     // queue entry after the one to be written
+
+  if ( _isRepeat()) {                                       // same card / key again = drop before it reaches the loop
+    _repeats++;
+
+    #if WIEGAND_STATS
+    _stats.repeats++;
+    #endif
+  } else if ( next == _tail) {                              // queue full = loop not reading fast enough
+    _overflow++;                                            // count (and drop) the frame instead of merging
+
+    #if WIEGAND_STATS
+    _stats.overruns++;
+    #endif
+  } else {
+    _queue[ _head].bitCount = _bitCount;                    // complete frame (bits already stored)
+
+    #if WIEGAND_STATS
+    _queue[ _head].time = _tick;                            // time of last bit
+    #endif
+    _head = next;                                           // publish frame to loop
+  }
+
+  _lastTick = _tick;                                        // window runs from last frame (dropped or not)
+  _bitCount = 0;                                            // reset counter
+}
+
+// <internal function:> true = frame in progress equals previous frame (still in queue) within repeat window
+bool Wiegand::_isRepeat()
+{
+  unsigned long window = ( _bitCount <= 8) ? _repeatKey : _repeatTag;
+  byte          last   = ( _head - 1) & ( WIEGAND_QUEUE_SIZE - 1);
+                                                            // previous frame (overwritten only after queue wrapped)
+  if (( window == 0) || ( _queue[ last].bitCount != _bitCount) || (( _tick - _lastTick) > window)) return false;
 
-  if ( _bitCount >= 34) return;                             // ignore last patity bit for WG 34
+  for ( byte i = 0; ( i < WIEGAND_FRAME_BYTES) && ( i * 8 < _bitCount); i++) {
+    if ( _queue[ last].data[ i] != _queue[ _head].data[ i]) return false;
+  }
 
-  _data <<= 1;                                              // shift lo bits left, new lo bit 0 = 0
-  _data |= ( bit & 0x01);                                   // add new bit 0 to lo bit 0
+  return true;
+}
+
+// <internal function:> close frame in progress if last bit received too long ago (called with interrupts blocked)
+void Wiegand::_endFrame()
+{
+  if (( _bitCount > 0) && (( micros() - _tick) > _timeout)) {
+    _closeFrame();                                          // elapsed = last bit received
+  }
 }
 
 bool Wiegand::_dataIsAvailable()
 {
-  unsigned long tick   = millis();                          // look at stopwatch
-  bool          result = false;                             // false = no valid tag available (yet)
+  bool result = false;                                      // false = no valid tag available (yet)
+
+  if ( _bitCount > 0) {                                     // frame in progress
+    noInterrupts();                                         // block (new) incoming bits while closing
+    _endFrame();
+    interrupts();                                           // allow (new) incoming bits
+  }
+
+  while ( !result && ( _tail != _head)) {                   // process queued frames (oldest first)
+    volatile WiegandFrame& entry = _queue[ _tail];          // entry owned by loop until released
+    WiegandFrame           frame;
+    WiegandCode            code;
+
+    frame.bitCount = entry.bitCount;                        // copy frame
+
+    #if WIEGAND_STATS
+    frame.time     = entry.time;
+    #endif
 
-  if (( tick - _tick) > WIEGAND_BITCOUNT_WAIT) {            // elapsed = last bit received
-    noInterrupts();                                         // block (new) incoming bits
-    result = _validateKeyData() | _validateTagData();       // process bits received (true = valid tag)
+    for ( byte i = 0; ( i < WIEGAND_FRAME_BYTES) && ( i * 8 < frame.bitCount); i++) {
+      frame.data[ i] = entry.data[ i];
+    }
+
+    _tail = ( _tail + 1) & ( WIEGAND_QUEUE_SIZE - 1);       // release queue entry to ISR
 
+    result = _validateKeyData( frame, code) || _validateTagData( frame, code);
+                                                            // process bits received (true = valid tag)
     if ( result) {
       #ifdef WIEGAND_DEBUG
       Serial.println();                                     // new line for bitstream debug
       #endif
 
-      _code = _data;                                        // set wiegand type (4/8/26/34)
-      _type = _bitCount;                                    // set wiegand type (4/8/26/34)
+      #if WIEGAND_STATS
+      if ( frame.bitCount <= 8) {
+        _stats.keys++;                                      // valid keypad frame
+      } else {
+        _stats.tags[ code.format]++;                        // valid tag frame
+      }
+
+      _stats.latency[ _bucket(( micros() - frame.time) / 1000)]++;
+      #endif
+
+      _frame    = frame;                                    // keep raw frame
+      _code64   = code.code;                                // set wiegand code
+      _code     = code.code;                                // set wiegand code (lo 32 bits)
+      _facility = code.facility;                            // set facility code
+      _card     = code.card;                                // set card number
+      _type   = frame.bitCount;                             // set wiegand type (4/8/26+)
 
       _dataToTagCode();                                     // convert reader data to tag code
       _dataToKeyCode();                                     // convert keypad data to key code
-    }
 
-    _clrDataBuffer();                                           // prepare for next tag
-    interrupts();                                           // allow (new) incoming bits
-	}
+      result = result & _available;                         // true = data received & processed
+    }
+  }
 
-  return result & _available;                               // true = data received & processed
+  return result;                                            // true = data received & processed
 }
 
-// <internal function:> validate reader based data (W26 / W34)
-bool Wiegand::_validateTagData()
+// <internal function:> validate reader based data (formats enabled in WiegandFormat.h)
+bool Wiegand::_validateTagData( const WiegandFrame& frame, WiegandCode& code)
 {
-  if (_bitCount == 26) {                                    // if type = W26
-    _data >>= 1;                                            // ignore last  parity bit
-    _data  &= 0x00FFFFFF;                                   // ignore first parity bit
-    return true;                                            // W34 (24 bits = first / last parity bit ignored)
+  byte bitCount = frame.bitCount;
+
+  if (( bitCount < 26) || ( bitCount > WIEGAND_MAX_BITS)) {
+    #if WIEGAND_STATS
+    if ( bitCount > WIEGAND_MAX_BITS) {
+      _stats.badLength++;                                   // too long (e.g. frames merged)
+    } else if (( bitCount != 4) && ( bitCount != 8)) {
+      _stats.badBitCount++;                                 // no reader / keypad length
+    }
+    #endif
+
+    return false;                                           // no valid reader data
   }
 
-  if (_bitCount == 34) {                                    // if type = W34
-    return true;                                            // W34 (32 bits = first / last parity bit ignored)
+  #if WIEGAND_STATS
+  if ( !WiegandFormats::match( bitCount)) {
+    _stats.badBitCount++;                                   // no format enabled for bit count
+    return false;
   }
+  #endif
 
-  return false;                                             // no valid reader data
+  uint64_t value = ( bitCount > 64) ? _frameBits( frame, bitCount - 64, 64) : _frameBits( frame, 0, bitCount);
+                                                            // frame as number (last bit = lo bit)
+  #if WIEGAND_STATS
+  if ( !WiegandFormats::decode( value, bitCount, code)) {
+    _stats.badParity++;                                     // format found, parity check failed
+    return false;
+  }
+
+  return true;
+  #else
+  return WiegandFormats::decode( value, bitCount, code);    // check parity & split facility / card
+  #endif
 }
 
 // <internal function> validate keypad based code (4 / 8 bit)
-bool Wiegand::_validateKeyData()
+bool Wiegand::_validateKeyData( const WiegandFrame& frame, WiegandCode& code)
 {
-  byte loNibble =   (_data & 0x0F);                         // first nibble = key
-  byte hiNibble = ~((_data & 0xF0) >> 4);                   // LO = ~HI (8 bit check)
+  byte hiNibble =   frame.data[ 0] >> 4;                    // first nibble received
+  byte loNibble =   frame.data[ 0] & 0x0F;                  // second nibble received
 
-  if (( _bitCount == 4) ||                                  // 4 bit = no error check
-  (( _bitCount == 8) && ( loNibble == hiNibble))) {         // 8 bit = do error check
-    _data = loNibble;                                       // ignore hiNibble
+  if ( frame.bitCount == 4) {                               // 4 bit = no error check
+    code.code = hiNibble;                                   // key = only nibble
+    code.facility = 0;
+    code.card     = 0;
     return true;                                            // return success
   }
 
+  if (( frame.bitCount == 8) && ( loNibble == ( ~hiNibble & 0x0F))) {
+    code.code = loNibble;                                   // 8 bit = do error check (LO = ~HI)
+    code.facility = 0;
+    code.card     = 0;
+    return true;                                            // return success
+  }
+
+  #if WIEGAND_STATS
+  if ( frame.bitCount == 8) _stats.badKeyNibble++;          // 8 bit check failed
+  #endif
+
   return false;                                             // return failure
 }
 
+// <internal function> return bit field (first bit, bit count <= 64) of frame
+uint64_t Wiegand::_frameBits( const WiegandFrame& frame, byte first, byte count)
+{
+  uint64_t bits = 0;
+
+  for ( byte i = first; i < first + count; i++) {
+    bits <<= 1;                                             // shift lo bits left, new lo bit 0 = 0
+    bits  |= ( frame.data[ i >> 3] >> ( 7 - ( i & 0x07))) & 0x01;
+  }
+
+  return bits;
+}
+
 // <internal function> store tag entry in tag code
 void Wiegand::_dataToTagCode()
 {
@@ -210,29 +877,32 @@ void Wiegand::_dataToTagCode()
 // <internal function> store key entry in key code
 void Wiegand::_dataToKeyCode()
 {
-  static unsigned long data = 0;                            // local code buffer
-
-  //IF_NOT_PASSED( WIEGAND_KEYPRESS_WAIT, true) return;       // debounce button
-
   if ( getType() == WKEY) {                                 // check if key data received
     _available = false;                                     // code not available (yet)
 
-    if (( _data >= 0) && ( _data <= 9)) {                   // if digit pressed
-      data = (( data * 10) + _data) % 1000000;              // add digit to code
+    unsigned long now = millis();
+
+    if ( _keyTimeout && (( now - _keyTime) > _keyTimeout)) _keyData = 0;
+                                                            // pause too long = new entry
+    _keyTime = now;
+
+    if ( _code <= 9) {                                      // if digit pressed
+      _keyData = (( _keyData * 10) + _code) % 1000000;      // add digit to code
     }
 
-    if ( _data == 10) {                                     // key '*' = clear entry
-    data = 0;
+    if ( _code == 10) {                                     // key '*' = clear entry
+      _keyData = 0;
     }
 
-    if ( _data == 11) {                                     // key '#' = confirm last digit
-      _code      = data;                                    // store as last code received
-      _keyCode   = data;                                    // store as key code
+    if ( _code == 11) {                                     // key '#' = confirm last digit
+      _code      = _keyData;                                // store as last code received
+      _code64    = _keyData;
+      _keyCode   = _keyData;                                // store as key code
       _available = true;                                    // publish code as available
 
-      data = 0;                                             // clear local code buffer (for new cylce)
+      _keyData = 0;                                         // clear local code buffer (for new cylce)
     }
   } else {
-    data = 0;                                               // clear local code buffer (no valid data)
+    _keyData = 0;                                           // clear local code buffer (no valid data)
   }
 }
@@ -9,11 +9,117 @@
 #ifndef _WIEGAND_H
 #define _WIEGAND_H
 
+#include "WiegandPlatform.h"
+#include "WiegandFormat.h"
+
 #define PIN_D0_DEFAULT 2                                    // default pin for line D0
 #define PIN_D1_DEFAULT 3                                    // default pin for line D1
 
-enum               WiegandType { NONE, WTAG, WKEY};         // indicates Wiegand data type (WTAG = 26/34, WKEY = 4/8)
-extern const char* WGTypeLabel[3];
+#ifndef WIEGAND_MAX_READERS
+#define WIEGAND_MAX_READERS 2                               // max number of readers decoded concurrently (one ISR pair each)
+#endif
+
+#ifndef WIEGAND_MAX_BITS
+#define WIEGAND_MAX_BITS 128                                // max bits per frame (longer frames are rejected)
+#endif
+
+#define WIEGAND_FRAME_BYTES (( WIEGAND_MAX_BITS + 7) / 8)   // bytes needed to store one frame
+
+#ifndef WIEGAND_QUEUE_SIZE
+#define WIEGAND_QUEUE_SIZE 4                                // completed frames buffered between ISR and loop (power of 2)
+#endif
+
+#ifndef WIEGAND_END_FACTOR
+#define WIEGAND_END_FACTOR 3                                // end of frame = no bit for WIEGAND_END_FACTOR bit intervals
+#endif
+
+#ifndef WIEGAND_END_MIN
+#define WIEGAND_END_MIN 1000                                // end of frame timeout lower bound (us)
+#endif
+
+#ifndef WIEGAND_END_MAX
+#define WIEGAND_END_MAX 25000                               // end of frame timeout upper bound (us, used until bit interval is known)
+#endif
+
+#ifndef WIEGAND_REPEAT_WINDOW
+#define WIEGAND_REPEAT_WINDOW 0                             // identical tag frames within window dropped (ms, 0 = all frames reported)
+#endif
+
+#ifndef WIEGAND_KEY_DEBOUNCE
+#define WIEGAND_KEY_DEBOUNCE 0                              // identical key frames within window dropped (ms, 0 = all keys reported)
+#endif
+
+#ifndef WIEGAND_KEY_TIMEOUT
+#define WIEGAND_KEY_TIMEOUT 10000                           // digits entered longer ago are discarded (ms, 0 = kept until '#' / '*')
+#endif
+
+#ifndef WIEGAND_TIMER
+#define WIEGAND_TIMER 0                                     // 1 = end of frame detected by a hardware timer (callbacks onTag / onPin)
+#endif
+
+#ifndef WIEGAND_TIMER_PERIOD
+#define WIEGAND_TIMER_PERIOD 2000                           // timer period (us)
+#endif
+
+#ifndef WIEGAND_STATS
+#define WIEGAND_STATS 0                                     // 1 = keep decoder statistics (getStats), 0 = no code / RAM used
+#endif
+
+#ifndef WIEGAND_CAPTURE
+#define WIEGAND_CAPTURE 0                                   // edges kept in a capture ring per reader (power of 2, 4 bytes each, 0 = no capture)
+#endif
+
+#ifndef WIEGAND_PCINT
+#define WIEGAND_PCINT 0                                     // 1 = lines D0 / D1 on pin change interrupts (any pin of a port, see WiegandPins.h)
+#endif
+
+#ifndef WIEGAND_PCINT_GROUPS
+#define WIEGAND_PCINT_GROUPS 0xFF                           // ports with a PCINT vector defined by the library (bit n = PCINTn_vect)
+#endif
+
+#if WIEGAND_PCINT
+#include "WiegandPins.h"                                    // unsupported MCU = #error
+#endif
+
+#if WIEGAND_CAPTURE
+#include "WiegandTrace.h"
+#endif
+
+#define WIEGAND_STATS_BUCKETS 8                             // histogram buckets (0 = 0, n = 2^(n-1) .. 2^n - 1, last = above)
+
+enum               WiegandType { NONE, WTAG, WKEY};         // indicates Wiegand data type (WTAG = 26+, WKEY = 4/8)
+extern const char* const WGTypeLabel_P[3];                  // labels in flash (PROGMEM, read with pgm_read_ptr), use getTypeLabel()
+extern const char*       WGTypeLabel[3] __attribute__(( deprecated( "use getTypeLabel() or WGTypeLabel_P")));
+                                                            // labels in RAM (as before, kept for older sketches)
+
+struct WiegandFrame {
+  byte data[ WIEGAND_FRAME_BYTES];                          // bits received (first bit = hi bit of data[0])
+  byte bitCount;                                            // number of bits received
+  #if WIEGAND_STATS
+  unsigned long time;                                       // time of last bit (us)
+  #endif
+};
+
+#if WIEGAND_TIMER
+typedef void ( *WiegandTagCallback)( uint64_t, byte);       // tag received (code without parity bits, bit count)
+typedef void ( *WiegandPinCallback)( unsigned long);        // PIN entered on keypad (confirmed with '#')
+#endif
+
+#if WIEGAND_STATS
+struct WiegandStats {
+  unsigned long keys;                                       // valid keypad frames (4 / 8 bit)
+  unsigned long tags[ WiegandFormats::count];               // valid tag frames per format (order of WiegandFormats)
+  unsigned long badBitCount;                                // rejected: no format enabled for bit count
+  unsigned long badLength;                                  // rejected: longer than WIEGAND_MAX_BITS (e.g. merged frames)
+  unsigned long badParity;                                  // rejected: parity check failed
+  unsigned long badKeyNibble;                               // rejected: 8 bit keypad check failed (lo nibble != ~hi nibble)
+  unsigned long overruns;                                   // dropped: frame queue full
+  unsigned long repeats;                                    // dropped: same frame again within repeat window
+  unsigned long timeouts;                                   // closed by the first bit of the next frame (loop polled too late)
+  unsigned int  isrTime[ WIEGAND_STATS_BUCKETS];            // ISR duration (us)
+  unsigned int  latency[ WIEGAND_STATS_BUCKETS];            // last bit received .. frame delivered by available() (ms)
+};
+#endif
 
 class Wiegand {
 public:
@@ -26,39 +132,151 @@ public:
 
   unsigned long getCode();                                  // returns the last active Wiegand code
   WiegandType   getType();                                  // returns the last active Wiegand type
+  const __FlashStringHelper* getTypeLabel();                // returns the label of the last active Wiegand type (flash string)
 
   unsigned long getTagCode();                               // returns the last active Wiegand code
   unsigned long getKeyCode();                               // returns the last active Wiegand code
 
+  uint64_t      getCode64();                                // returns the last active Wiegand code (up to 64 bits)
+  unsigned long getFacilityCode();                          // returns the facility code of the last active tag
+  uint64_t      getCardNumber();                            // returns the card number of the last active tag
+  byte          getBitCount();                              // returns the bit count of the last active frame
+  byte          getRawData( byte*, byte);                   // copies the last active frame (returns bit count)
+
+  unsigned long getBitInterval();                           // returns the learned bit interval of the reader (us)
+  unsigned int  getOverflowCount();                         // returns number of frames dropped on a full queue
+  unsigned int  getRepeatCount();                           // returns number of repeated frames dropped
+
+  void          setRepeatWindow( unsigned int, unsigned int = WIEGAND_KEY_DEBOUNCE);
+                                                            // drop identical frames within window (tag ms, key ms, 0 = off)
+  void          setKeyTimeout( unsigned long);              // discard digits entered longer ago (ms, 0 = off)
+
+  static bool   idle( unsigned long = 0);                   // sleep until a frame of any reader is complete (true) or ms elapsed (false, 0 = no limit)
+
+  #if WIEGAND_TIMER
+  void          onTag( WiegandTagCallback);                 // called for each tag received (from timer context, 0 = none)
+  void          onPin( WiegandPinCallback);                 // called for each PIN entered (from timer context, 0 = none)
+  #endif
+
+  #if WIEGAND_STATS
+  void          getStats( WiegandStats&);                   // copies the decoder statistics
+  void          clearStats();                               // resets the decoder statistics
+  #endif
+
+  #if WIEGAND_CAPTURE
+  bool          readEdge( WiegandEdge&);                    // removes the oldest captured edge (false = none)
+  unsigned int  getEdgeCount();                             // returns number of edges captured (not yet read)
+  unsigned long getEdgesLost();                             // returns number of edges overwritten before read (ring full)
+  unsigned int  dumpTrace( WiegandTraceWriter&);            // writes captured edges as trace (returns edges written)
+  #endif
+
 protected:
   int _pinD0;                                               // digital pin for reading line D0
   int _pinD1;                                               // digital pin for reading line D1
 
   unsigned long _code;                                      // last active Wiegand code
+  uint64_t      _code64;                                    // last active Wiegand code (up to 64 bits)
+  unsigned long _facility;                                  // last active facility code
+  uint64_t      _card;                                      // last active card number
+  WiegandFrame  _frame;                                     // last active frame (raw bits)
   int           _type;                                      // last active Wiegand type
   bool          _available;                                 // last active Wiegand code
 
   unsigned long _tagCode;                                   // last active Wiegand code
   unsigned long _keyCode;                                   // last active Wiegand code
 
-  static volatile unsigned long _tick;                      // stopwatch for last received bit
-  static volatile unsigned long _data;                      // buffer for storing received bits
-  static volatile int           _bitCount;                  // number of bits received (so far)
+  unsigned long _keyData;                                   // key code being entered (digits so far)
+  unsigned long _keyTime;                                   // millis() of last digit entered
+  unsigned long _keyTimeout;                                // digits older than timeout discarded (ms, 0 = off)
+
+  byte          _reader;                                    // reader index (= ISR pair) assigned by begin()
+
+  #if WIEGAND_PCINT
+  byte          _groupD0;                                   // port (pin change group) of line D0
+  byte          _maskD0;                                    // bit mask of line D0 in port
+  byte          _groupD1;                                   // port (pin change group) of line D1
+  byte          _maskD1;                                    // bit mask of line D1 in port
+
+  static byte   _pcintLast[ WIEGAND_PIN_GROUPS];            // port value at previous pin change (per port)
+  static byte   _pcintLine[ WIEGAND_PIN_GROUPS][ 8];        // reader / line of port bit (reader * 2 + line + 1, 0 = none)
+  static void   _enablePCINT( byte, byte);                  // enable pin change interrupt of pins (port, mask)
+  #endif
+
+  volatile unsigned long _tick;                             // stopwatch for last received bit (us)
+  volatile unsigned long _interval;                         // learned bit interval (us, 0 = unknown)
+  volatile unsigned long _timeout;                          // end of frame timeout (us, from _interval)
+  volatile byte          _bitCount;                         // number of bits received (so far, stored in _queue[ _head])
+
+  volatile WiegandFrame  _queue[ WIEGAND_QUEUE_SIZE];       // frames (ISR = producer / loop = consumer, _head = frame in progress)
+  volatile byte          _head;                             // next queue entry to be written (by ISR)
+  volatile byte          _tail;                             // next queue entry to be read (by loop)
+  volatile unsigned int  _overflow;                         // number of frames dropped (queue full)
+  volatile unsigned int  _repeats;                          // number of repeated frames dropped
+  unsigned long          _repeatTag;                        // tag frame repeat window (us, 0 = off)
+  unsigned long          _repeatKey;                        // key frame repeat window (us, 0 = off)
+  volatile unsigned long _lastTick;                         // time of last bit of previous frame (us)
+
+  #if WIEGAND_TIMER
+  WiegandTagCallback     _onTag;                            // tag callback (0 = none)
+  WiegandPinCallback     _onPin;                            // PIN callback (0 = none)
+  volatile bool          _delivered;                        // code delivered by timer context (not yet seen by available)
+
+  static volatile bool   _dispatching;                      // true = timer context is decoding frames
+  static void            _timerISR();                       // end of frame detection + callbacks (all readers)
+  void                   _dispatch();                       // call callback for last code
+  #endif
+
+  #if WIEGAND_STATS
+  volatile WiegandStats  _stats;                            // decoder statistics (updated by ISR and loop)
+
+  static byte _bucket( unsigned long);                      // histogram bucket of value
+  #endif
+
+  #if WIEGAND_CAPTURE
+  volatile uint32_t      _edges[ WIEGAND_CAPTURE];          // captured edges (micros() with bit 0 = line, 2 us resolution)
+  volatile unsigned int  _edgeHead;                         // next edge written (by ISR)
+  volatile unsigned int  _edgeTail;                         // oldest edge (moved by ISR when ring full)
+  volatile unsigned long _edgesLost;                        // edges overwritten before read
+  unsigned long          _edgesTraced;                      // edges lost already marked in trace
+  #endif
+
+  static Wiegand* _readers[ WIEGAND_MAX_READERS];           // active readers (indexed by reader index)
+  static byte     _readerCount;                             // number of readers started
+
+  static void _sleep( bool);                                // sleep until next interrupt (true = no timer needed)
 
   void _clrCodeValues();                                    // reset last tag / key code values
   void _clrDataBuffer();                                    // reset data read buffer
 
-  static void _pulseD0();                                   // process bits coming on line D0
-  static void _pulseD1();                                   // process bits coming on line D0
-  static void _writeDx( volatile byte);                     // store received bits in read buffer
+  template< byte N> static void _pulseD0();                 // process bits coming on line D0 (reader N)
+  template< byte N> static void _pulseD1();                 // process bits coming on line D1 (reader N)
+  template< byte N> static void _attachISR( byte, int, int);// attach ISR pair of reader index (unrolled at compile time)
+
+public:
+  #if WIEGAND_PCINT
+  static inline void _pulsePCINT( byte);                    // process falling edges of port (all readers on port, PCINT vector)
+  #endif
+
+protected:
+
+  void _writeDx( byte);                                     // store received bits in read buffer
+  void _closeFrame();                                       // move received bits to the frame queue
+  bool _isRepeat();                                         // true = frame in progress repeats previous frame within window
+  void _endFrame();                                         // close frame if end of frame detected
+  void _learnInterval( unsigned long);                      // adapt bit interval / end of frame timeout to gap (us)
 
   bool _dataIsAvailable();                                  // read data from reader or key pad
 
-  bool _validateTagData();                                  // validate reader based data (W26 / W34)
-  bool _validateKeyData();                                  // validate keypad based data (4 / 8 bit)
+  bool _validateTagData( const WiegandFrame&, WiegandCode&);// validate reader based data (enabled formats)
+  bool _validateKeyData( const WiegandFrame&, WiegandCode&);// validate keypad based data (4 / 8 bit)
+
+  static uint64_t _frameBits( const WiegandFrame&, byte, byte);
+                                                            // return bit field (first bit, bit count) of frame
 
   void _dataToTagCode();                                    // convert reader based data to tag code
   void _dataToKeyCode();                                    // convert keypad based data to key code
 };
 
+template<> void Wiegand::_attachISR< 0>( byte, int, int);   // end of compile time recursion (see Wiegand.cpp)
+
 #endif
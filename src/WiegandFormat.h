@@ -0,0 +1,282 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandFormat.h
+// Purpose    : Compile time Wiegand format descriptors (bit length, parity, facility / card fields)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_FORMAT_H
+#define _WIEGAND_FORMAT_H
+
+#include "WiegandPlatform.h"
+
+// formats to compile in (1 = enabled / 0 = disabled, e.g. -D WIEGAND_FORMAT_W37=1 as build flag)
+// disabled formats cost no flash or RAM; the first enabled format matching the bit count is used
+
+#ifdef  WIEGAND_FORMAT_ALL                                  // enable all formats below
+#define WIEGAND_FORMAT_W35 1
+#define WIEGAND_FORMAT_W37 1
+#define WIEGAND_FORMAT_W48 1
+#define WIEGAND_FORMAT_W56 1
+#define WIEGAND_FORMAT_W64 1
+#define WIEGAND_FORMAT_RAW 1
+#endif
+
+#ifndef WIEGAND_FORMAT_W26
+#define WIEGAND_FORMAT_W26 1                                // HID H10301 (8 bit facility / 16 bit card)
+#endif
+#ifndef WIEGAND_FORMAT_W34
+#define WIEGAND_FORMAT_W34 1                                // 34 bit (16 bit facility / 16 bit card)
+#endif
+#ifndef WIEGAND_FORMAT_W35
+#define WIEGAND_FORMAT_W35 0                                // HID Corporate 1000 35 bit (12 bit facility / 20 bit card)
+#endif
+#ifndef WIEGAND_FORMAT_W37
+#define WIEGAND_FORMAT_W37 0                                // HID H10304 (16 bit facility / 19 bit card)
+#endif
+#ifndef WIEGAND_FORMAT_W48
+#define WIEGAND_FORMAT_W48 0                                // HID Corporate 1000 48 bit (22 bit facility / 23 bit card)
+#endif
+#ifndef WIEGAND_FORMAT_W56
+#define WIEGAND_FORMAT_W56 0                                // 56 bit UID (7 byte UID, no parity)
+#endif
+#ifndef WIEGAND_FORMAT_W64
+#define WIEGAND_FORMAT_W64 0                                // 64 bit UID (8 byte UID, no parity)
+#endif
+#ifndef WIEGAND_FORMAT_RAW
+#define WIEGAND_FORMAT_RAW 0                                // any other length >= 26 bit (last 64 bits, no parity)
+#endif
+
+#define WIEGAND_EVEN  false                                 // parity check = even number of bits set
+#define WIEGAND_ODD   true                                  // parity check = odd number of bits set
+#define WIEGAND_NOBIT 0xFF                                  // parity check not used
+
+struct WiegandCode {
+  uint64_t      code;                                       // code without parity bits (facility + card)
+  unsigned long facility;                                   // facility code (0 = format without facility)
+  uint64_t      card;                                       // card number
+  byte          format;                                     // format decoding the frame (index in WiegandFormats)
+};
+
+// mask of bits first .. first + count - 1 (0 = first bit received) in a frame of bits (last bit received = lo bit)
+constexpr uint64_t wgRange( byte bits, byte first, byte count)
+{
+  return (( count >= 64) ? ~0ULL : (( 1ULL << count) - 1)) << ( bits - first - count);
+}
+
+// mask of bits first .. last in a frame of bits, skipping every bit at position % 3 = skip
+constexpr uint64_t wgEvery3( byte bits, byte first, byte last, byte skip)
+{
+  return ( first > last) ? 0 : ((( first % 3) == skip) ? 0 : wgRange( bits, first, 1)) | wgEvery3( bits, first + 1, last, skip);
+}
+
+// returns true if an odd number of bits is set (popcount parity)
+inline bool wgParity( uint64_t value)
+{
+  return __builtin_popcountll( value) & 0x01;
+}
+
+// format descriptor: bit count, facility / card field and up to 3 parity checks (mask incl. parity bit, parity bit, odd / even)
+template< byte BITS, byte FC_FIRST, byte FC_COUNT, byte CN_FIRST, byte CN_COUNT,
+          uint64_t P1_MASK = 0, byte P1_BIT = WIEGAND_NOBIT, bool P1_ODD = WIEGAND_EVEN,
+          uint64_t P2_MASK = 0, byte P2_BIT = WIEGAND_NOBIT, bool P2_ODD = WIEGAND_EVEN,
+          uint64_t P3_MASK = 0, byte P3_BIT = WIEGAND_NOBIT, bool P3_ODD = WIEGAND_EVEN>
+struct WiegandFormatDef {
+  static const byte bitCount = BITS;                        // frame length
+
+  static bool match( byte bits)                             // true = format applies to bit count
+  {
+    return bits == BITS;
+  }
+
+  static bool decode( uint64_t value, WiegandCode& code)    // check parity and split fields (true = valid)
+  {
+    if ( P1_MASK && ( wgParity( value & P1_MASK) != P1_ODD)) return false;
+    if ( P2_MASK && ( wgParity( value & P2_MASK) != P2_ODD)) return false;
+    if ( P3_MASK && ( wgParity( value & P3_MASK) != P3_ODD)) return false;
+
+    code.facility = _field( value, FC_FIRST, FC_COUNT);
+    code.card     = _field( value, CN_FIRST, CN_COUNT);
+    code.code     = ( FC_COUNT == 0) ? code.card : ((( uint64_t) code.facility << ( CN_COUNT % 64)) | code.card);
+
+    return true;
+  }
+
+  static uint64_t encode( unsigned long facility, uint64_t card)
+                                                            // frame of fields with parity bits set (last bit = lo bit)
+  {
+    uint64_t value = _place( facility, FC_FIRST, FC_COUNT) | _place( card, CN_FIRST, CN_COUNT);
+
+    value = _parity( value, P1_MASK, P1_BIT, P1_ODD);       // in order of calculation (as decode)
+    value = _parity( value, P2_MASK, P2_BIT, P2_ODD);
+    value = _parity( value, P3_MASK, P3_BIT, P3_ODD);
+
+    return value;
+  }
+
+  static uint64_t _field( uint64_t value, byte first, byte count)
+  {
+    return ( count == 0) ? 0 : ( value & wgRange( BITS, first, count)) >> ( BITS - first - count);
+  }
+
+  static uint64_t _place( uint64_t field, byte first, byte count)
+  {
+    return ( count == 0) ? 0 : ( field << ( BITS - first - count)) & wgRange( BITS, first, count);
+  }
+
+  static uint64_t _parity( uint64_t value, uint64_t mask, byte bit, bool odd)
+  {
+    if ( !mask) return value;
+
+    uint64_t parity = wgRange( BITS, bit, 1);               // parity bit (part of mask)
+
+    return ( wgParity( value & mask & ~parity) != odd) ? ( value | parity) : ( value & ~parity);
+  }
+};
+
+// any frame length (no parity, no facility, card = last 64 bits received)
+struct WiegandFormatRaw {
+  static const byte bitCount = 0;                           // any frame length
+
+  static bool match( byte bits)
+  {
+    return bits >= 26;
+  }
+
+  static bool decode( uint64_t value, WiegandCode& code)
+  {
+    code.facility = 0;
+    code.card     = value;
+    code.code     = value;
+
+    return true;
+  }
+
+  static uint64_t encode( unsigned long, uint64_t card)     // frame = card (length chosen by sender)
+  {
+    return card;
+  }
+};
+
+// format table (bit count, facility field, card field, parity checks)
+typedef WiegandFormatDef< 26,  1,  8,  9, 16,               // HID H10301
+          wgRange( 26,  0, 13),  0, WIEGAND_EVEN,
+          wgRange( 26, 13, 13), 25, WIEGAND_ODD>  WiegandFormatW26;
+
+typedef WiegandFormatDef< 34,  1, 16, 17, 16,               // 34 bit (HID H10306)
+          wgRange( 34,  0, 17),  0, WIEGAND_EVEN,
+          wgRange( 34, 17, 17), 33, WIEGAND_ODD>  WiegandFormatW34;
+
+typedef WiegandFormatDef< 35,  2, 12, 14, 20,               // HID Corporate 1000 35 bit (checked in order of calculation)
+          wgEvery3( 35, 1, 33, 1) | wgRange( 35, 1, 1),  1, WIEGAND_EVEN,
+          wgEvery3( 35, 1, 33, 0) | wgRange( 35, 34, 1), 34, WIEGAND_ODD,
+          wgRange( 35,  0, 35),  0, WIEGAND_ODD>  WiegandFormatW35;
+
+typedef WiegandFormatDef< 37,  1, 16, 17, 19,               // HID H10304
+          wgRange( 37,  0, 19),  0, WIEGAND_EVEN,
+          wgRange( 37, 18, 19), 36, WIEGAND_ODD>  WiegandFormatW37;
+
+typedef WiegandFormatDef< 48,  2, 22, 24, 23,               // HID Corporate 1000 48 bit (checked in order of calculation)
+          wgEvery3( 48, 1, 46, 1) | wgRange( 48, 1, 1),  1, WIEGAND_EVEN,
+          wgEvery3( 48, 1, 46, 0) | wgRange( 48, 47, 1), 47, WIEGAND_ODD,
+          wgRange( 48,  0, 48),  0, WIEGAND_ODD>  WiegandFormatW48;
+
+typedef WiegandFormatDef< 56,  0,  0,  0, 56>  WiegandFormatW56;
+                                                            // 56 bit UID (no parity)
+typedef WiegandFormatDef< 64,  0,  0,  0, 64>  WiegandFormatW64;
+                                                            // 64 bit UID (no parity)
+
+struct WiegandFormatEnd {};                                 // end of format list
+
+// list of enabled formats, resolved at compile time (first matching format decodes the frame)
+template< class F, class... NEXT>
+struct WiegandFormatList {
+  static const byte count = 1 + WiegandFormatList< NEXT...>::count;
+                                                            // number of enabled formats
+
+  static bool match( byte bits)                             // true = a format applies to bit count
+  {
+    return F::match( bits) || WiegandFormatList< NEXT...>::match( bits);
+  }
+
+  static bool decode( uint64_t value, byte bits, WiegandCode& code, byte index = 0)
+  {
+    if ( F::match( bits)) {                                 // format found for bit count
+      code.format = index;
+      return F::decode( value, code);
+    }
+
+    return WiegandFormatList< NEXT...>::decode( value, bits, code, index + 1);
+  }
+
+  static byte bitCount( byte index)                         // frame length of format at index (0 = any)
+  {
+    return ( index == 0) ? F::bitCount : WiegandFormatList< NEXT...>::bitCount( index - 1);
+  }
+
+  static bool encode( byte bits, unsigned long facility, uint64_t card, uint64_t& value)
+                                                            // frame of bit count with parity (false = no format enabled)
+  {
+    if ( F::match( bits)) {                                 // same format as decode() uses for bit count
+      value = F::encode( facility, card);
+      return true;
+    }
+
+    return WiegandFormatList< NEXT...>::encode( bits, facility, card, value);
+  }
+};
+
+template<>
+struct WiegandFormatList< WiegandFormatEnd> {
+  static const byte count = 0;
+
+  static bool match( byte)
+  {
+    return false;
+  }
+
+  static bool decode( uint64_t, byte, WiegandCode&, byte = 0)
+  {
+    return false;                                           // no format enabled for bit count
+  }
+
+  static byte bitCount( byte)
+  {
+    return 0;
+  }
+
+  static bool encode( byte, unsigned long, uint64_t, uint64_t&)
+  {
+    return false;
+  }
+};
+
+typedef WiegandFormatList<
+#if WIEGAND_FORMAT_W26
+  WiegandFormatW26,
+#endif
+#if WIEGAND_FORMAT_W34
+  WiegandFormatW34,
+#endif
+#if WIEGAND_FORMAT_W35
+  WiegandFormatW35,
+#endif
+#if WIEGAND_FORMAT_W37
+  WiegandFormatW37,
+#endif
+#if WIEGAND_FORMAT_W48
+  WiegandFormatW48,
+#endif
+#if WIEGAND_FORMAT_W56
+  WiegandFormatW56,
+#endif
+#if WIEGAND_FORMAT_W64
+  WiegandFormatW64,
+#endif
+#if WIEGAND_FORMAT_RAW
+  WiegandFormatRaw,
+#endif
+  WiegandFormatEnd> WiegandFormats;
+
+#endif
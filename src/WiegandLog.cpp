@@ -0,0 +1,207 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandLog.cpp
+// Purpose    : Access event log (ring of fixed size records in a storage region, written in batches)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// records are only appended: each record position is written once per lap of the ring (wear spread over the region),
+// the newest record is the valid record with the highest sequence number (no header to update)
+
+#include "WiegandPlatform.h"
+#include "WiegandLog.h"
+
+#define WIEGAND_LOG_CHECK 0x5747                            // checksum xor ("WG"), erased (0xFF / 0x00) records are invalid
+
+// log in storage (nothing read before begin)
+WiegandLog::WiegandLog( WiegandStorage& storage) : _storage( storage)
+{
+  _capacity   = 0;                                          // not started
+  _head       = 0;
+  _count      = 0;
+  _sequence   = 0;
+  _staged     = 0;
+  _stagedTime = 0;
+  _clock      = 0;
+  _millis     = millis();
+}
+
+// find newest record in storage (one pass, false = storage too small)
+bool WiegandLog::begin()
+{
+  _storage.begin();
+
+  unsigned long capacity = _storage.length() / sizeof( WiegandLogRecord);
+
+  if ( capacity > WIEGAND_LOG_MAX) capacity = WIEGAND_LOG_MAX;
+  if ( capacity < 2) return false;
+
+  _capacity = capacity;
+  _head     = 0;                                            // empty log = start at position 0
+  _count    = 0;
+  _staged   = 0;
+
+  bool     found  = false;
+  uint16_t newest = 0;
+  uint16_t oldest = 0;
+
+  for ( unsigned int i = 0; i < _capacity; i++) {
+    WiegandLogRecord record;
+
+    _storage.get(( unsigned long) i * sizeof( WiegandLogRecord), record);
+
+    if ( !_valid( record)) continue;                        // never written / write interrupted
+
+    if ( !found || (( int16_t)( record.sequence - oldest) < 0)) oldest = record.sequence;
+
+    if ( !found || (( int16_t)( record.sequence - newest) > 0)) {
+      newest = record.sequence;
+      _head  = ( i + 1) % _capacity;                        // next record behind newest
+    }
+
+    found = true;
+  }
+
+  if ( found) {                                             // span oldest .. newest (damaged records in between count, read() skips them)
+    _count = ( uint16_t)( newest - oldest) + 1;
+
+    if ( _count > _capacity) _count = _capacity;
+  }
+
+  _sequence = found ? newest + 1 : 0;
+
+  return true;
+}
+
+// set clock (seconds, e.g. unix time from an RTC / NTP)
+void WiegandLog::setTime( unsigned long time)
+{
+  _clock  = time;
+  _millis = millis();
+}
+
+// returns the clock (seconds); whole seconds move into _clock, so millis() overflow is no issue
+unsigned long WiegandLog::getTime()
+{
+  unsigned long elapsed = ( millis() - _millis) / 1000;
+
+  _clock  += elapsed;
+  _millis += elapsed * 1000;
+
+  return _clock;
+}
+
+// stage record in RAM (no storage write unless the buffer is full because handle() is not called)
+void WiegandLog::add( unsigned long tag, int slot, WiegandAccess access, byte door)
+{
+  if ( _capacity == 0) return;                              // not started
+  if ( _staged == WIEGAND_LOG_BUFFER) flush();              // buffer full (fallback)
+
+  WiegandLogRecord& record = _buffer[ _staged];
+
+  record.time     = getTime();
+  record.tag      = tag;
+  record.sequence = _sequence++;
+  record.slot     = slot;
+  record.access   = access;
+  record.door     = door;
+  record.check    = _checksum( record);
+
+  if ( _staged++ == 0) _stagedTime = millis();              // age of batch
+}
+
+// write staged records when buffer full or oldest staged record older than WIEGAND_LOG_DELAY (call in loop)
+void WiegandLog::handle()
+{
+  if ( _staged == 0) return;
+
+  if (( _staged == WIEGAND_LOG_BUFFER) || ( millis() - _stagedTime >= WIEGAND_LOG_DELAY)) flush();
+}
+
+// write staged records to the ring (one commit per batch)
+void WiegandLog::flush()
+{
+  if ( _staged == 0) return;
+
+  for ( byte i = 0; i < _staged; i++) {
+    _storage.put(( unsigned long) _head * sizeof( WiegandLogRecord), _buffer[ i]);
+
+    if ( ++_head == _capacity) _head = 0;                   // wrap = oldest record overwritten
+    if ( _count < _capacity) _count++;
+  }
+
+  _staged = 0;
+  _storage.commit();
+}
+
+// cursor of oldest record
+uint16_t WiegandLog::first()
+{
+  return _sequence - _staged - _count;
+}
+
+// cursor behind newest record (staged records included)
+uint16_t WiegandLog::end()
+{
+  return _sequence;
+}
+
+// read record at cursor and advance cursor (cursor of overwritten record = oldest record, false = end reached)
+bool WiegandLog::read( uint16_t& cursor, WiegandLogRecord& record)
+{
+  uint16_t stored = _sequence - _staged;                    // sequence of first staged record
+
+  if (( int16_t)( cursor - first()) < 0) cursor = first();  // reader too slow = records lost (gap in sequence)
+
+  while (( int16_t)( cursor - _sequence) < 0) {
+    if (( int16_t)( cursor - stored) >= 0) {
+      record = _buffer[ cursor - stored];                   // staged record
+      cursor++;
+      return true;
+    }
+
+    unsigned int back     = ( uint16_t)( stored - cursor);  // records behind head
+    unsigned int position = ( _head + _capacity - back) % _capacity;
+
+    _storage.get(( unsigned long) position * sizeof( WiegandLogRecord), record);
+    cursor++;
+
+    if ( _valid( record)) return true;                      // skip record damaged by an interrupted write
+  }
+
+  return false;
+}
+
+// returns number of records kept (stored + staged)
+unsigned int WiegandLog::getCount()
+{
+  return _count + _staged;
+}
+
+// returns number of records fitting in storage (0 = not started)
+unsigned int WiegandLog::getCapacity()
+{
+  return _capacity;
+}
+
+// <internal function:> Fletcher-16 of record (check excluded)
+uint16_t WiegandLog::_checksum( const WiegandLogRecord& record)
+{
+  const byte* bytes = ( const byte*) &record;
+  uint16_t    sum1  = 0;
+  uint16_t    sum2  = 0;
+
+  for ( byte i = 0; i < sizeof( WiegandLogRecord) - sizeof( record.check); i++) {
+    sum1 = ( sum1 + bytes[ i]) % 255;
+    sum2 = ( sum2 + sum1) % 255;
+  }
+
+  return (( sum2 << 8) | sum1) ^ WIEGAND_LOG_CHECK;
+}
+
+// <internal function:> true = checksum ok
+bool WiegandLog::_valid( const WiegandLogRecord& record)
+{
+  return record.check == _checksum( record);
+}
@@ -0,0 +1,74 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandLog.h
+// Purpose    : Access event log (ring of fixed size records in a storage region, written in batches)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_LOG_H
+#define _WIEGAND_LOG_H
+
+#include "WiegandPlatform.h"
+#include "WiegandStorage.h"
+#include "WiegandRules.h"
+
+#ifndef WIEGAND_LOG_BUFFER
+#define WIEGAND_LOG_BUFFER 4                                // records staged in RAM before a batch is written (16 bytes each)
+#endif
+
+#ifndef WIEGAND_LOG_DELAY
+#define WIEGAND_LOG_DELAY 2000                              // max time a record stays staged (ms, written by handle())
+#endif
+
+#define WIEGAND_LOG_MAX 0x7FFF                              // max records in ring (sequence numbers compared modulo 2^16)
+
+struct WiegandLogRecord {                                   // one access event (16 bytes, no padding)
+  uint32_t time;                                            // seconds (clock set by setTime, e.g. unix time)
+  uint32_t tag;                                             // tag presented (tag of PIN owner for PIN events, 0 = unknown)
+  uint16_t sequence;                                        // record number (newest record found by begin)
+  int16_t  slot;                                            // slot of tag in tag table (-1 = not stored)
+  byte     access;                                          // WiegandAccess decision (WG_NONE = no rules)
+  byte     door;                                            // door of reader
+  uint16_t check;                                           // checksum (erased / partly written record = invalid)
+};
+
+class WiegandLog {
+public:
+  WiegandLog( WiegandStorage&);                             // log in storage (e.g. WiegandStorage_EEPROM region behind the tag table)
+
+  bool          begin();                                    // find newest record (false = storage too small)
+  void          setTime( unsigned long);                    // set clock (seconds), runs on millis()
+  unsigned long getTime();                                  // returns the clock (seconds)
+
+  void          add( unsigned long, int, WiegandAccess, byte = 0);
+                                                            // stage record in RAM (tag, slot, decision, door), no storage write
+  void          handle();                                   // write staged records when buffer full or WIEGAND_LOG_DELAY elapsed (call in loop)
+  void          flush();                                    // write staged records now (one commit)
+
+  uint16_t      first();                                    // cursor of oldest record
+  uint16_t      end();                                      // cursor behind newest record (staged records included)
+  bool          read( uint16_t&, WiegandLogRecord&);        // read record at cursor and advance cursor (false = end reached)
+
+  unsigned int  getCount();                                 // returns number of records kept (stored + staged)
+  unsigned int  getCapacity();                              // returns number of records fitting in storage
+
+protected:
+  WiegandStorage&  _storage;                                // storage device holding the ring
+  unsigned int     _capacity;                               // records in ring
+  unsigned int     _head;                                   // ring position of next record written
+  unsigned int     _count;                                  // records stored, oldest .. newest (up to _capacity)
+  uint16_t         _sequence;                               // sequence of next record staged
+
+  WiegandLogRecord _buffer[ WIEGAND_LOG_BUFFER];            // records staged (not yet in storage)
+  byte             _staged;                                 // number of records staged
+  unsigned long    _stagedTime;                             // millis() of first record staged
+
+  unsigned long    _clock;                                  // clock at _millis (seconds)
+  unsigned long    _millis;                                 // millis() at setTime
+
+  static uint16_t _checksum( const WiegandLogRecord&);      // Fletcher-16 of record (check excluded)
+  static bool     _valid( const WiegandLogRecord&);         // true = checksum ok
+};
+
+#endif
@@ -0,0 +1,324 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandOut.cpp
+// Purpose    : Sending Wiegand frames (tags / keys / relayed frames) on lines D0 / D1, timed by a hardware timer
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// timer (only with -D WIEGAND_OUT=1): AVR = timer 2 (compare B, ISR defined = no tone() / PWM on pins 3 and 11),
+// ESP8266 = timer1 (no analogWrite / Servo), ESP32 = esp_timer, host = WiegandNative::alarm; begin() returns false
+// without WIEGAND_OUT and on other platforms
+
+#include "WiegandPlatform.h"
+#include "WiegandOut.h"
+
+#if WIEGAND_OUT && ( defined( ARDUINO_ARCH_AVR) || defined( ESP8266) || defined( ESP32) || !defined( ARDUINO))
+#define WGOUT_SUPPORTED 1                                   // platform with a timer for WiegandOut (timer claimed)
+#else
+#define WGOUT_SUPPORTED 0                                   // no timer code / ISR compiled in, begin() returns false
+#endif
+
+#if WGOUT_SUPPORTED && defined( ESP32)
+#include <esp_timer.h>
+static esp_timer_handle_t WiegandOutTimer = 0;
+#endif
+
+#if defined( ESP8266)
+#define WGOUT_ISR IRAM_ATTR                                 // timer1 interrupt code in RAM
+#else
+#define WGOUT_ISR
+#endif
+
+WiegandOut* WiegandOut::_active = 0;                        // transmitter using the timer
+
+#if WGOUT_SUPPORTED && defined( ARDUINO_ARCH_AVR)
+static volatile byte WiegandOutLoops;                       // compare periods left in phase
+
+ISR( TIMER2_COMPB_vect)                                     // compare B (compare A is used by tone())
+{
+  if ( WiegandOutLoops) {
+    WiegandOutLoops--;                                      // long phase = several compare periods
+  } else {
+    WiegandOut::_timerISR();
+  }
+}
+#endif
+
+#if WGOUT_SUPPORTED && defined( ESP32)
+static void WiegandOutCallback( void*)
+{
+  WiegandOut::_timerISR();
+}
+#endif
+
+// output pins for D0 / D1, pulse width, bit interval, gap after frame (us)
+WiegandOut::WiegandOut( int pinD0, int pinD1, unsigned int width, unsigned int interval, unsigned long gap)
+{
+  _pinD0 = pinD0;
+  _pinD1 = pinD1;
+  _head  = 0;                                               // empty queue
+  _tail  = 0;
+  _bit   = 0;
+  _phase = WGOUT_IDLE;
+
+  if ( interval <= width) interval = 2 * width;             // lines must return high between bits
+
+  _setTiming( WGOUT_IDLE,  0);
+  _setTiming( WGOUT_PULSE, width);
+  _setTiming( WGOUT_SPACE, interval - width);
+  _setTiming( WGOUT_GAP,   gap);
+}
+
+// lines high, timer ready (false = other transmitter active / no timer on platform)
+bool WiegandOut::begin()
+{
+  if ( !WGOUT_SUPPORTED) return false;
+  if ( _active && ( _active != this)) return false;         // one transmitter per timer
+
+  _active = this;
+
+  #if defined( ARDUINO_ARCH_AVR)
+  _portD0 = portOutputRegister( digitalPinToPort( _pinD0));
+  _maskD0 = digitalPinToBitMask( _pinD0);
+  _portD1 = portOutputRegister( digitalPinToPort( _pinD1));
+  _maskD1 = digitalPinToBitMask( _pinD1);
+  #endif
+
+  digitalWrite( _pinD0, HIGH);                              // idle = high (before output = no glitch)
+  digitalWrite( _pinD1, HIGH);
+  pinMode( _pinD0, OUTPUT);
+  pinMode( _pinD1, OUTPUT);
+
+  #if WGOUT_SUPPORTED && defined( ESP8266)
+  timer1_isr_init();
+  timer1_attachInterrupt( _timerISR);
+  timer1_enable( TIM_DIV16, TIM_EDGE, TIM_SINGLE);          // 5 ticks per us, one shot
+  #elif WGOUT_SUPPORTED && defined( ESP32)
+  if ( !WiegandOutTimer) {
+    esp_timer_create_args_t args = {};
+
+    args.callback = WiegandOutCallback;
+    args.name     = "wiegand";
+    esp_timer_create( &args, &WiegandOutTimer);
+  }
+  #endif
+
+  return true;
+}
+
+// queue frame (first bit = hi bit of buffer[0], false = queue full / not started)
+bool WiegandOut::send( const byte* buffer, byte bits)
+{
+  if (( _active != this) || ( bits == 0) || ( bits > WIEGAND_MAX_BITS)) return false;
+
+  byte next = ( _head + 1) & ( WIEGAND_OUT_QUEUE - 1);
+
+  if ( next == _tail) return false;                         // queue full (entry _tail is being sent)
+
+  volatile WiegandFrame& frame = _queue[ _head];
+
+  for ( byte i = 0; i < ( bits + 7) / 8; i++) frame.data[ i] = buffer[ i];
+  frame.bitCount = bits;
+
+  noInterrupts();
+  _head = next;                                             // publish frame
+
+  if ( _phase == WGOUT_IDLE) {                              // timer stopped = start with first pulse
+    _phase = _step();
+    _start( _phase);
+  }
+  interrupts();
+
+  return true;
+}
+
+// queue frame (last bit = lo bit, bit count <= 64)
+bool WiegandOut::send( uint64_t value, byte bits)
+{
+  byte buffer[ 8];
+
+  if (( bits == 0) || ( bits > 64)) return false;           // no frame (shift by 64 undefined)
+
+  value <<= 64 - bits;                                      // first bit = hi bit
+
+  for ( byte i = 0; i < 8; i++) buffer[ i] = ( value >> ( 56 - 8 * i)) & 0xFF;
+
+  return send( buffer, bits);
+}
+
+// queue tag encoded by the format of bit count (same format table as the receiver)
+bool WiegandOut::sendTag( unsigned long facility, uint64_t card, byte bits)
+{
+  uint64_t value;
+
+  if ( !WiegandFormats::encode( bits, facility, card, value)) return false;
+                                                            // no format enabled for bit count
+  return send( value, bits);
+}
+
+// queue keypad key (0..9, 10 = '*', 11 = '#'; 8 bit = inverted nibble first)
+bool WiegandOut::sendKey( byte key, byte bits)
+{
+  key &= 0x0F;
+
+  return ( bits == 8) ? send(( uint64_t)((( ~key & 0x0F) << 4) | key), 8) : send(( uint64_t) key, 4);
+}
+
+// queue PIN as keys + '#' (all or nothing: false = fewer free queue entries than digits + 1)
+bool WiegandOut::sendPin( unsigned long pin, byte bits)
+{
+  unsigned long d    = 1;
+  byte          keys = 2;                                   // first digit + '#'
+
+  while ( pin / d >= 10) { d *= 10; keys++; }               // first digit
+
+  if ( keys > WIEGAND_OUT_QUEUE - 1 - pending()) return false;
+                                                            // timer only frees entries (check holds while queueing)
+  for ( ; d; d /= 10) {
+    if ( !sendKey(( pin / d) % 10, bits)) return false;
+  }
+
+  return sendKey( 11, bits);
+}
+
+// queue last frame received by reader (bits as received, tag frames of any length)
+bool WiegandOut::relay( Wiegand& reader)
+{
+  byte buffer[ WIEGAND_FRAME_BYTES];
+  byte bits = reader.getRawData( buffer, sizeof( buffer));
+
+  return send( buffer, bits);
+}
+
+// true = frames queued or being sent
+bool WiegandOut::busy()
+{
+  return _phase != WGOUT_IDLE;
+}
+
+// returns number of frames queued (incl. frame being sent)
+byte WiegandOut::pending()
+{
+  return ( _head - _tail) & ( WIEGAND_OUT_QUEUE - 1);
+}
+
+// <internal function:> next phase (timer interrupt)
+void WGOUT_ISR WiegandOut::_timerISR()
+{
+  WiegandOut* out = _active;
+
+  if ( !out) return;
+
+  out->_phase = out->_step();
+
+  if ( out->_phase == WGOUT_IDLE) {
+    out->_stop();
+  } else {
+    out->_start( out->_phase);
+  }
+}
+
+// <internal function:> drive lines for next phase (end of pulse = lines high, otherwise next bit low), returns phase
+byte WGOUT_ISR WiegandOut::_step()
+{
+  if ( _phase == WGOUT_PULSE) {
+    _line( 0, false);                                       // end of pulse
+    _line( 1, false);
+
+    if ( ++_bit < _queue[ _tail].bitCount) return WGOUT_SPACE;
+
+    _bit  = 0;                                              // frame sent
+    _tail = ( _tail + 1) & ( WIEGAND_OUT_QUEUE - 1);
+
+    return WGOUT_GAP;
+  }
+
+  if ( _head == _tail) return WGOUT_IDLE;                   // queue empty
+
+  byte bit = _queue[ _tail].data[ _bit >> 3] & ( 0x80 >> ( _bit & 0x07));
+
+  _line( bit ? 1 : 0, true);                                // pulse on D1 = 1 / D0 = 0
+
+  return WGOUT_PULSE;
+}
+
+// <internal function:> set line (0 = D0 / 1 = D1, true = low)
+void WGOUT_ISR WiegandOut::_line( byte line, bool low)
+{
+  #if defined( ARDUINO_ARCH_AVR)
+  volatile uint8_t* port = line ? _portD1 : _portD0;        // one register write
+  uint8_t           mask = line ? _maskD1 : _maskD0;
+
+  if ( low) {
+    *port &= ~mask;
+  } else {
+    *port |=  mask;
+  }
+  #else
+  digitalWrite( line ? _pinD1 : _pinD0, low ? LOW : HIGH);
+  #endif
+}
+
+// <internal function:> run timer for phase
+void WGOUT_ISR WiegandOut::_start( byte phase)
+{
+  const WiegandOutTiming& timing = _timing[ phase];
+
+  #if WGOUT_SUPPORTED && defined( ARDUINO_ARCH_AVR)
+  TCCR2B          = 0;                                      // stop, CTC mode (top = OCR2A)
+  TCCR2A          = 1 << WGM21;
+  TCNT2           = 0;
+  OCR2A           = timing.ocr;
+  OCR2B           = timing.ocr;                             // compare B at top
+  WiegandOutLoops = timing.loops;
+  TIFR2           = 1 << OCF2B;
+  TIMSK2          = 1 << OCIE2B;
+  TCCR2B          = timing.cs;                              // start with prescaler
+  #elif WGOUT_SUPPORTED && defined( ESP8266)
+  timer1_write( timing.ticks);
+  #elif WGOUT_SUPPORTED && defined( ESP32)
+  esp_timer_start_once( WiegandOutTimer, timing.ticks);
+  #elif WGOUT_SUPPORTED && !defined( ARDUINO)
+  WiegandNative::alarm( _timerISR, timing.ticks);
+  #else
+  ( void) timing;                                           // no timer (begin() returned false)
+  #endif
+}
+
+// <internal function:> stop timer
+void WGOUT_ISR WiegandOut::_stop()
+{
+  #if WGOUT_SUPPORTED && defined( ARDUINO_ARCH_AVR)
+  TCCR2B = 0;
+  TIMSK2 = 0;
+  #endif
+}
+
+// <internal function:> timer setting of phase (us); AVR = smallest prescaler fitting 256 ticks, longer = several periods
+void WiegandOut::_setTiming( byte phase, unsigned long us)
+{
+  WiegandOutTiming& timing = _timing[ phase];
+
+  #if defined( ARDUINO_ARCH_AVR)
+  static const uint16_t prescaler[] = { 1, 8, 32, 64, 128, 256, 1024 };
+                                                            // timer 2 clock select 1 .. 7
+  for ( byte cs = 0; cs < 7; cs++) {
+    unsigned long ticks = us * ( F_CPU / 1000000UL) / prescaler[ cs];
+
+    if (( ticks <= 256) || ( cs == 6)) {
+      if ( ticks == 0) ticks = 1;
+
+      timing.ticks = ticks;
+      timing.cs    = cs + 1;
+      timing.loops = ( ticks - 1) / 256;
+      timing.ocr   = ticks / ( timing.loops + 1) - 1;
+      break;
+    }
+  }
+  #elif defined( ESP8266)
+  timing.ticks = us * 5;                                    // TIM_DIV16 = 5 MHz
+  #else
+  timing.ticks = us;
+  #endif
+}
@@ -0,0 +1,95 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandOut.h
+// Purpose    : Sending Wiegand frames (tags / keys / relayed frames) on lines D0 / D1, timed by a hardware timer
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_OUT_H
+#define _WIEGAND_OUT_H
+
+#include "WiegandPlatform.h"
+#include "Wiegand.h"
+
+#ifndef WIEGAND_OUT
+#define WIEGAND_OUT 0                                       // 1 = transmitter timer compiled in (AVR timer 2, ESP8266 timer1, ESP32 esp_timer)
+#endif
+
+#ifndef WIEGAND_OUT_WIDTH
+#define WIEGAND_OUT_WIDTH 50                                // pulse width (us)
+#endif
+
+#ifndef WIEGAND_OUT_INTERVAL
+#define WIEGAND_OUT_INTERVAL 2000                           // bit interval (us, start to start)
+#endif
+
+#ifndef WIEGAND_OUT_GAP
+#define WIEGAND_OUT_GAP 30000                               // pause after a frame (us, receiver end of frame)
+#endif
+
+#ifndef WIEGAND_OUT_QUEUE
+#define WIEGAND_OUT_QUEUE 8                                 // frames waiting to be sent (power of 2, 8 = 6 digit PIN + '#')
+#endif
+
+#define WGOUT_IDLE  0                                       // timer phases: stopped
+#define WGOUT_PULSE 1                                       // line low (pulse width)
+#define WGOUT_SPACE 2                                       // lines high until next bit (interval - width)
+#define WGOUT_GAP   3                                       // lines high after frame
+
+struct WiegandOutTiming {                                   // timer setting of a phase (platform specific)
+  unsigned long ticks;                                      // timer ticks (us on ESP / host)
+  #if defined( ARDUINO_ARCH_AVR)
+  byte          cs;                                         // timer 2 clock select (prescaler)
+  byte          ocr;                                        // compare value
+  byte          loops;                                      // extra compare periods (long phases)
+  #endif
+};
+
+class WiegandOut {
+public:
+  WiegandOut( int, int, unsigned int = WIEGAND_OUT_WIDTH, unsigned int = WIEGAND_OUT_INTERVAL, unsigned long = WIEGAND_OUT_GAP);
+                                                            // output pins for D0 / D1, pulse width, bit interval, gap (us)
+  bool begin();                                             // lines high, timer ready (false = other transmitter active / no WIEGAND_OUT)
+
+  bool send( const byte*, byte);                            // queue frame (first bit = hi bit of buffer[0], bit count)
+  bool send( uint64_t, byte);                               // queue frame (last bit = lo bit, bit count <= 64)
+  bool sendTag( unsigned long, uint64_t, byte = 26);        // queue tag encoded by the format of bit count (facility, card, bits)
+  bool sendKey( byte, byte = 4);                            // queue keypad key (0..9, 10 = '*', 11 = '#', 4 / 8 bit)
+  bool sendPin( unsigned long, byte = 4);                   // queue PIN as keys + '#' (all or nothing)
+  bool relay( Wiegand&);                                    // queue last frame received by reader (bits as received)
+
+  bool busy();                                              // true = frames queued or being sent
+  byte pending();                                           // returns number of frames queued (incl. frame being sent)
+
+  static void _timerISR();                                  // next phase (called by the timer interrupt)
+
+protected:
+  int                    _pinD0;                            // output pin of line D0
+  int                    _pinD1;                            // output pin of line D1
+
+  WiegandOutTiming       _timing[ 4];                       // timer setting per phase (WGOUT_PULSE .. WGOUT_GAP)
+
+  volatile WiegandFrame  _queue[ WIEGAND_OUT_QUEUE];        // frames (loop = producer / timer = consumer)
+  volatile byte          _head;                             // next queue entry to be written (by loop)
+  volatile byte          _tail;                             // frame being sent (by timer)
+  volatile byte          _bit;                              // bit of frame being sent
+  volatile byte          _phase;                            // current phase (WGOUT_IDLE = timer stopped)
+
+  #if defined( ARDUINO_ARCH_AVR)
+  volatile uint8_t*      _portD0;                           // output register / mask of lines (no digitalWrite in ISR)
+  uint8_t                _maskD0;
+  volatile uint8_t*      _portD1;
+  uint8_t                _maskD1;
+  #endif
+
+  static WiegandOut*     _active;                           // transmitter using the timer
+
+  byte _step();                                             // drive lines for next phase, returns phase
+  void _line( byte, bool);                                  // set line (0 = D0 / 1 = D1, true = low)
+  void _start( byte);                                       // run timer for phase
+  void _stop();                                             // stop timer
+  void _setTiming( byte, unsigned long);                    // timer setting of phase (phase, us)
+};
+
+#endif
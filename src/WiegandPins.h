@@ -0,0 +1,102 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandPins.h
+// Purpose    : Compile time pin map (input port / bit mask / pin change interrupt group) for direct port access
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_PINS_H
+#define _WIEGAND_PINS_H
+
+#include "WiegandPlatform.h"
+
+#define WIEGAND_NOGROUP 0xFF                                // pin without pin change interrupt
+
+#if defined( __AVR_ATmega328P__) || defined( __AVR_ATmega328__) || defined( __AVR_ATmega168__)
+
+#define WIEGAND_PIN_GROUPS 3                                // PCINT0 = port B, PCINT1 = port C, PCINT2 = port D
+
+// pin change interrupt group of pin (Uno / Nano / Pro Mini: D0..D7 = port D, D8..D13 = port B, A0..A5 = port C)
+constexpr byte wgPinGroup( byte pin)
+{
+  return ( pin < 8) ? 2 : ( pin < 14) ? 0 : ( pin < 20) ? 1 : WIEGAND_NOGROUP;
+}
+
+// bit mask of pin in its port
+constexpr byte wgPinMask( byte pin)
+{
+  return ( pin < 8) ? ( 1 << pin) : ( pin < 14) ? ( 1 << ( pin - 8)) : ( pin < 20) ? ( 1 << ( pin - 14)) : 0;
+}
+
+// input register of group
+inline volatile uint8_t& wgGroupInput( byte group)
+{
+  return ( group == 0) ? PINB : ( group == 1) ? PINC : PIND;
+}
+
+// pin change mask register of group
+inline volatile uint8_t& wgGroupMask( byte group)
+{
+  return ( group == 0) ? PCMSK0 : ( group == 1) ? PCMSK1 : PCMSK2;
+}
+
+#elif defined( __AVR_ATmega32U4__)
+
+#define WIEGAND_PIN_GROUPS 1                                // PCINT0 = port B (only port with pin change interrupts)
+
+// pin change interrupt group of pin (Leonardo / Micro: D8..D11, D14..D17 = port B)
+constexpr byte wgPinGroup( byte pin)
+{
+  return ((( pin >= 8) && ( pin <= 11)) || (( pin >= 14) && ( pin <= 17))) ? 0 : WIEGAND_NOGROUP;
+}
+
+// bit mask of pin in port B
+constexpr byte wgPinMask( byte pin)
+{
+  return (( pin >= 8) && ( pin <= 11)) ? ( 1 << ( pin - 4)) :
+         ( pin == 14) ? 0x08 : ( pin == 15) ? 0x02 : ( pin == 16) ? 0x04 : ( pin == 17) ? 0x01 : 0;
+}
+
+inline volatile uint8_t& wgGroupInput( byte)
+{
+  return PINB;
+}
+
+inline volatile uint8_t& wgGroupMask( byte)
+{
+  return PCMSK0;
+}
+
+#elif !defined( ARDUINO)
+
+#define WIEGAND_PIN_GROUPS ( WIEGAND_NATIVE_PINS / 8)       // host: 8 pins per simulated port
+
+constexpr byte wgPinGroup( byte pin)
+{
+  return ( pin < WIEGAND_NATIVE_PINS) ? ( pin >> 3) : WIEGAND_NOGROUP;
+}
+
+constexpr byte wgPinMask( byte pin)
+{
+  return ( pin < WIEGAND_NATIVE_PINS) ? ( 1 << ( pin & 0x07)) : 0;
+}
+
+inline volatile uint8_t& wgGroupInput( byte group)
+{
+  return WiegandNative::port( group);
+}
+
+#else
+
+#error "WIEGAND_PCINT: no pin map for this MCU (ATmega328P / ATmega168 / ATmega32U4 only, e.g. not ATmega2560)"
+
+#endif
+
+// bit index of a single bit mask (0..7, port bit -> pin change dispatch slot)
+constexpr byte wgPinBit( byte mask)
+{
+  return ( mask > 0x01) ? 1 + wgPinBit( mask >> 1) : 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandPlatform.h
+// Purpose    : Platform layer (Arduino core on target, simulated hardware on a host)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_PLATFORM_H
+#define _WIEGAND_PLATFORM_H
+
+#if defined( ARDUINO)
+#include <Arduino.h>                                        // millis, digitalRead, attachInterrupt, ...
+#else
+#include "WiegandNative.h"                                  // host build (see extras/native, -I extras/native)
+#endif
+
+#if defined( ESP8266) || defined( ESP32) || !defined( ARDUINO)
+#define WIEGAND_EEPROM_EMULATED                             // EEPROM = RAM copy (needs EEPROM.begin / EEPROM.commit)
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandRules.cpp
+// Purpose    : Access rules per group (doors + weekly schedule bitmap), evaluated in constant time
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include "WiegandPlatform.h"
+#include "WiegandRules.h"
+
+// all groups above 0 denied (until allowed)
+WiegandRules::WiegandRules()
+{
+  for ( byte group = 1; group <= WIEGAND_RULES_GROUPS; group++) clear( group);
+
+  _minute = 0;                                              // Monday 00:00 (until setTime)
+  _millis = millis();
+}
+
+// set clock (day 0 = Monday); call again from an RTC / NTP at least daily, as millis() drifts (resonator up to 0.5%)
+void WiegandRules::setTime( byte day, byte hour, byte minute)
+{
+  _minute = (( day % 7) * 24 + hour) * 60 + minute;
+  _millis = millis();
+}
+
+// returns the minute of the week (0 = Monday 00:00); whole minutes move into _minute, so millis() overflow is no issue
+unsigned int WiegandRules::getMinute()
+{
+  unsigned long elapsed = ( millis() - _millis) / 60000UL;
+
+  _minute  = ( _minute + elapsed % WIEGAND_RULES_WEEK) % WIEGAND_RULES_WEEK;
+  _millis += elapsed * 60000UL;
+
+  return _minute;
+}
+
+// set doors of group (bit n = door n, doors 0 .. 7)
+void WiegandRules::setDoors( byte group, byte doors)
+{
+  if (( group == 0) || ( group > WIEGAND_RULES_GROUPS)) return;
+
+  _rules[ group - 1].doors = doors;
+}
+
+// add time window to group (days = WG_WEEKDAYS, ..., from / to = minute of day, to excluded; to < from = until next day)
+void WiegandRules::allow( byte group, byte days, unsigned int from, unsigned int to)
+{
+  if (( group == 0) || ( group > WIEGAND_RULES_GROUPS)) return;
+
+  WiegandRule& rule = _rules[ group - 1];
+  unsigned int length = ( to + 24 * 60 - from) % ( 24 * 60);
+
+  if ( length == 0) length = 24 * 60;                       // from = to = whole day
+
+  for ( byte day = 0; day < 7; day++) {
+    if ( !( days & ( 1 << day))) continue;
+
+    unsigned int start = day * 24 * 60 + from;              // compiled into slot bits once
+
+    for ( unsigned int m = 0; m < length; m += WIEGAND_RULES_SLOT) {
+      unsigned int slot = (( start + m) % WIEGAND_RULES_WEEK) / WIEGAND_RULES_SLOT;
+
+      rule.week[ slot >> 3] |= 1 << ( slot & 0x07);
+    }
+  }
+}
+
+// group denied (no doors, no time)
+void WiegandRules::clear( byte group)
+{
+  if (( group == 0) || ( group > WIEGAND_RULES_GROUPS)) return;
+
+  memset( &_rules[ group - 1], 0, sizeof( WiegandRule));
+}
+
+// decision for stored key at door 0 .. 7: WG_GRANTED / WG_WRONG_DOOR / WG_OUT_OF_TIME (PIN not checked here)
+WiegandAccess WiegandRules::check( unsigned long key, byte door)
+{
+  byte group = WG_KEY_GROUP( key);
+
+  if ( group == 0) return WG_GRANTED;                       // no rule
+  if ( group > WIEGAND_RULES_GROUPS) return WG_WRONG_DOOR;  // unknown group
+  if ( door  > 7)                    return WG_WRONG_DOOR;  // no bit in door mask (byte)
+
+  const WiegandRule& rule = _rules[ group - 1];
+  unsigned int       slot = getMinute() / WIEGAND_RULES_SLOT;
+
+  if ( !( rule.doors & ( 1 << door)))                    return WG_WRONG_DOOR;
+  if ( !( rule.week[ slot >> 3] & ( 1 << ( slot & 0x07)))) return WG_OUT_OF_TIME;
+
+  return WG_GRANTED;
+}
+
+// read rules from storage address (false = no rules of this size stored)
+bool WiegandRules::load( WiegandStorage& storage, unsigned long address)
+{
+  uint16_t magic;
+  uint16_t size;
+
+  storage.get( address, magic);
+  storage.get( address + 2, size);
+
+  if (( magic != WIEGAND_RULES_MAGIC) || ( size != sizeof( _rules))) return false;
+
+  storage.get( address + 4, _rules);
+  return true;
+}
+
+// write rules to storage address (4 + WIEGAND_RULES_GROUPS * ( 1 + WIEGAND_RULES_BYTES) bytes)
+void WiegandRules::save( WiegandStorage& storage, unsigned long address)
+{
+  uint16_t magic = WIEGAND_RULES_MAGIC;
+  uint16_t size  = sizeof( _rules);
+
+  storage.put( address, magic);
+  storage.put( address + 2, size);
+  storage.put( address + 4, _rules);
+  storage.commit();
+}
@@ -0,0 +1,71 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandRules.h
+// Purpose    : Access rules per group (doors + weekly schedule bitmap), evaluated in constant time
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_RULES_H
+#define _WIEGAND_RULES_H
+
+#include "WiegandPlatform.h"
+#include "WiegandStorage.h"
+
+#ifndef WIEGAND_RULES_GROUPS
+#define WIEGAND_RULES_GROUPS 4                              // groups 1 .. n with a rule (group 0 = any door, any time)
+#endif
+
+#ifndef WIEGAND_RULES_SLOT
+#define WIEGAND_RULES_SLOT 15                               // minutes per schedule bit (15 = 672 bits = 84 bytes per group)
+#endif
+
+#define WIEGAND_RULES_WEEK  ( 7 * 24 * 60)                  // minutes per week
+#define WIEGAND_RULES_SLOTS ( WIEGAND_RULES_WEEK / WIEGAND_RULES_SLOT)
+#define WIEGAND_RULES_BYTES (( WIEGAND_RULES_SLOTS + 7) / 8)
+#define WIEGAND_RULES_MAGIC 0x5752                          // stored rules ("WR")
+
+#define WG_KEY( group, pin) (((( unsigned long)( group)) << 24) | (( pin) & 0x00FFFFFFUL))
+                                                            // stored key = access group (hi byte) + PIN (0 = no PIN)
+#define WG_KEY_GROUP( key)  (( byte)(( key) >> 24))
+#define WG_KEY_PIN( key)    (( key) & 0x00FFFFFFUL)
+
+#define WG_MONDAY   0x01                                    // days of allow() (bit 0 = Monday .. bit 6 = Sunday)
+#define WG_SATURDAY 0x20
+#define WG_SUNDAY   0x40
+#define WG_WEEKDAYS 0x1F
+#define WG_WEEKEND  0x60
+#define WG_ALLDAYS  0x7F
+
+enum WiegandAccess { WG_NONE, WG_GRANTED, WG_ENTER_PIN, WG_UNKNOWN, WG_WRONG_DOOR, WG_OUT_OF_TIME, WG_BAD_PIN};
+                                                            // access decision (WG_NONE = no decision yet)
+
+struct WiegandRule {
+  byte doors;                                               // doors allowed (bit n = door n, doors 0 .. 7)
+  byte week[ WIEGAND_RULES_BYTES];                          // slots allowed (bit n = WIEGAND_RULES_SLOT minutes from Monday 00:00 + n * WIEGAND_RULES_SLOT)
+};
+
+class WiegandRules {
+public:
+  WiegandRules();                                           // all groups above 0 denied
+
+  void          setTime( byte, byte, byte);                 // set clock (day 0 = Monday, hour, minute), runs on millis() until set again
+  unsigned int  getMinute();                                // returns the minute of the week (0 = Monday 00:00)
+
+  void          setDoors( byte, byte);                      // set doors of group (group, door mask)
+  void          allow( byte, byte, unsigned int, unsigned int);
+                                                            // add time window to group (group, days, from / to minute of day)
+  void          clear( byte);                               // group denied (no doors, no time)
+
+  WiegandAccess check( unsigned long, byte);                // decision for stored key at door 0 .. 7 (group rule, current time)
+
+  bool          load( WiegandStorage&, unsigned long);      // read rules from storage address (false = none stored)
+  void          save( WiegandStorage&, unsigned long);      // write rules to storage address
+
+protected:
+  WiegandRule   _rules[ WIEGAND_RULES_GROUPS];              // rules of group 1 .. WIEGAND_RULES_GROUPS
+  unsigned int  _minute;                                    // minute of week at _millis (moved on by getMinute)
+  unsigned long _millis;                                    // millis() at setTime
+};
+
+#endif
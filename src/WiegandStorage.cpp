@@ -0,0 +1,65 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandStorage.cpp
+// Purpose    : Storage backends for the tag database (on-board EEPROM, FRAM, ... = bytes rewritable in place)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include "WiegandPlatform.h"
+#ifdef ARDUINO
+#include <EEPROM.h>
+#endif
+#include "WiegandStorage.h"
+
+WiegandStorage_EEPROM WiegandEEPROM;                        // complete on-board EEPROM
+
+// prepare EEPROM (flash emulated EEPROM needs a RAM copy)
+void WiegandStorage_EEPROM::begin()
+{
+  #ifdef WIEGAND_EEPROM_EMULATED
+  static bool started = false;                              // shared by all regions
+
+  if ( !started) EEPROM.begin( WIEGAND_EEPROM_SIZE);
+  started = true;
+  #endif
+}
+
+// size of region (bytes)
+unsigned long WiegandStorage_EEPROM::length()
+{
+  unsigned long size = EEPROM.length();                     // size of EEPROM
+
+  if ( _start >= size) return 0;                            // region outside EEPROM
+  if (( _size > 0) && ( _start + _size < size)) return _size;
+
+  return size - _start;                                     // region up to end of EEPROM
+}
+
+// read bytes from region
+void WiegandStorage_EEPROM::read( unsigned long address, void* data, unsigned int size)
+{
+  byte* bytes = ( byte*) data;
+
+  for ( unsigned int i = 0; i < size; i++) {
+    bytes[ i] = EEPROM.read( _start + address + i);
+  }
+}
+
+// write bytes to region (unchanged bytes are skipped to save EEPROM wear)
+void WiegandStorage_EEPROM::write( unsigned long address, const void* data, unsigned int size)
+{
+  const byte* bytes = ( const byte*) data;
+
+  for ( unsigned int i = 0; i < size; i++) {
+    if ( EEPROM.read( _start + address + i) != bytes[ i]) EEPROM.write( _start + address + i, bytes[ i]);
+  }
+}
+
+// complete writes
+void WiegandStorage_EEPROM::commit()
+{
+  #ifdef WIEGAND_EEPROM_EMULATED
+  EEPROM.commit();                                          // copy RAM copy to flash
+  #endif
+}
@@ -0,0 +1,62 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandStorage.h
+// Purpose    : Storage backends for the tag database (on-board EEPROM, FRAM, ... = bytes rewritable in place)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#ifndef _WIEGAND_STORAGE_H
+#define _WIEGAND_STORAGE_H
+
+#include "WiegandPlatform.h"
+
+#ifndef WIEGAND_EEPROM_SIZE
+#define WIEGAND_EEPROM_SIZE 512                             // EEPROM size for flash emulated EEPROM (ESP8266 / ESP32)
+#endif
+
+// byte addressable storage device; implement read / write / length for other devices (e.g. an SPI FRAM); the tag
+// database rewrites single bytes in place (slots, journal entries), so write() must not need an erase first: raw
+// flash (erase per page / sector) is not supported directly, only behind a RAM page copy (as EEPROM on ESP8266 / ESP32)
+class WiegandStorage {
+public:
+  virtual void          begin() {}                          // prepare device (called before first use)
+  virtual unsigned long length() = 0;                       // size of device (bytes)
+  virtual void          read( unsigned long, void*, unsigned int) = 0;
+                                                            // read bytes (address, buffer, size)
+  virtual void          write( unsigned long, const void*, unsigned int) = 0;
+                                                            // write bytes (address, buffer, size)
+  virtual void          commit() {}                         // complete writes (e.g. flash emulated EEPROM)
+
+  template< typename T> T& get( unsigned long address, T& t)
+  {
+    read( address, &t, sizeof( T));                         // read object (byte-wise)
+    return t;
+  }
+
+  template< typename T> const T& put( unsigned long address, const T& t)
+  {
+    write( address, &t, sizeof( T));                        // write object (byte-wise)
+    return t;
+  }
+};
+
+// (region of) the on-board EEPROM
+class WiegandStorage_EEPROM : public WiegandStorage {
+public:
+  constexpr WiegandStorage_EEPROM( unsigned long start = 0, unsigned long size = 0) : _start( start), _size( size) {}
+                                                            // region (size 0 = up to end of EEPROM)
+  void          begin();
+  unsigned long length();
+  void          read( unsigned long, void*, unsigned int);
+  void          write( unsigned long, const void*, unsigned int);
+  void          commit();
+
+protected:
+  unsigned long _start;                                     // first EEPROM address of region
+  unsigned long _size;                                      // size of region (0 = up to end of EEPROM)
+};
+
+extern WiegandStorage_EEPROM WiegandEEPROM;                 // complete on-board EEPROM (default storage)
+
+#endif
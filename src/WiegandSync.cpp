@@ -0,0 +1,292 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandSync.cpp
+// Purpose    : Bulk import / export of the tag database over a Stream (Serial, TCP client, ...) in CRC checked frames
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include "WiegandPlatform.h"
+#include "WiegandSync.h"
+#include "Wiegand_EEPROM.h"
+
+#define STATE_START   0                                     // waiting for WGSYNC_START
+#define STATE_TYPE    1
+#define STATE_LENGTH  2
+#define STATE_PAYLOAD 3
+#define STATE_CRC_LO  4
+#define STATE_CRC_HI  5
+
+// framing on a transport
+WiegandSyncLink::WiegandSyncLink( Stream& stream) : _stream( stream)
+{
+  _index  = 0;
+  _state  = STATE_START;
+  _crc    = 0;
+  _status = WGSYNC_OK;
+  _errors = 0;
+}
+
+// send frame (type, payload, length)
+void WiegandSyncLink::send( byte type, const byte* payload, byte length)
+{
+  uint16_t crc = crc16( crc16( 0xFFFF, type), length);
+
+  for ( byte i = 0; i < length; i++) crc = crc16( crc, payload[ i]);
+
+  _stream.write(( uint8_t) WGSYNC_START);
+  _stream.write(( uint8_t) type);
+  _stream.write(( uint8_t) length);
+  _stream.write( payload, length);
+  _stream.write(( uint8_t)( crc & 0xFF));
+  _stream.write(( uint8_t)( crc >> 8));
+}
+
+// read bytes available (true = frame complete, getStatus() != WGSYNC_OK = frame rejected)
+bool WiegandSyncLink::receive()
+{
+  while ( _stream.available() > 0) {
+    byte value = _stream.read();
+
+    switch ( _state) {
+      case STATE_START:
+        if ( value == WGSYNC_START) _state = STATE_TYPE;    // skip bytes between frames (resync after an error)
+        break;
+      case STATE_TYPE:
+        _frame[ 0] = value;
+        _state     = STATE_LENGTH;
+        break;
+      case STATE_LENGTH:
+        _frame[ 1] = value;
+        _index     = 0;
+
+        if ( value > WGSYNC_PAYLOAD) {                      // does not fit frame buffer
+          _frame[ 1] = 0;
+          _state     = STATE_START;
+          _status    = WGSYNC_BAD_DATA;
+          _errors++;
+
+          return true;
+        }
+
+        _state = value ? STATE_PAYLOAD : STATE_CRC_LO;
+        break;
+      case STATE_PAYLOAD:
+        _frame[ 2 + _index++] = value;
+
+        if ( _index == _frame[ 1]) _state = STATE_CRC_LO;
+        break;
+      case STATE_CRC_LO:
+        _crc   = value;
+        _state = STATE_CRC_HI;
+        break;
+      case STATE_CRC_HI: {
+        uint16_t crc = 0xFFFF;
+
+        _crc  |= ( uint16_t) value << 8;
+        _state = STATE_START;
+
+        for ( byte i = 0; i < 2 + _frame[ 1]; i++) crc = crc16( crc, _frame[ i]);
+
+        _status = ( crc == _crc) ? WGSYNC_OK : WGSYNC_BAD_CRC;
+        if ( _status != WGSYNC_OK) _errors++;
+
+        return true;                                        // frame complete (rest of bytes read on next call)
+      }
+    }
+  }
+
+  return false;
+}
+
+// returns the type of the last frame received
+byte WiegandSyncLink::getType()
+{
+  return _frame[ 0];
+}
+
+// returns the payload length of the last frame received
+byte WiegandSyncLink::getLength()
+{
+  return _frame[ 1];
+}
+
+// returns the payload of the last frame received
+const byte* WiegandSyncLink::getPayload()
+{
+  return _frame + 2;
+}
+
+// returns the result of the last frame received (WGSYNC_OK / WGSYNC_BAD_CRC / WGSYNC_BAD_DATA)
+byte WiegandSyncLink::getStatus()
+{
+  return _status;
+}
+
+// returns the number of frames rejected
+unsigned int WiegandSyncLink::getErrors()
+{
+  return _errors;
+}
+
+// CRC-16 CCITT (polynomial 0x1021, start 0xFFFF) of next byte
+uint16_t WiegandSyncLink::crc16( uint16_t crc, byte value)
+{
+  crc ^= ( uint16_t) value << 8;
+
+  for ( byte i = 0; i < 8; i++) {
+    crc = ( crc & 0x8000) ? ( crc << 1) ^ 0x1021 : ( crc << 1);
+  }
+
+  return crc;
+}
+
+// encode record (op, tag, key = little endian)
+void WiegandSyncLink::putRecord( byte* buffer, byte op, uint32_t tag, uint32_t key)
+{
+  buffer[ 0] = op;
+
+  for ( byte i = 0; i < 4; i++) {
+    buffer[ 1 + i] = ( tag >> ( 8 * i)) & 0xFF;
+    buffer[ 5 + i] = ( key >> ( 8 * i)) & 0xFF;
+  }
+}
+
+// decode record (returns op)
+byte WiegandSyncLink::getRecord( const byte* buffer, uint32_t& tag, uint32_t& key)
+{
+  tag = 0;
+  key = 0;
+
+  for ( byte i = 0; i < 4; i++) {
+    tag |= ( uint32_t) buffer[ 1 + i] << ( 8 * i);
+    key |= ( uint32_t) buffer[ 5 + i] << ( 8 * i);
+  }
+
+  return buffer[ 0];
+}
+
+// device side of the tag database
+WiegandSync::WiegandSync( Wiegand_EEPROM& db, Stream& stream) : WiegandSyncLink( stream), _db( db)
+{
+  _count = 0;
+}
+
+// process bytes received (true = frame handled)
+bool WiegandSync::handle()
+{
+  if ( !receive()) return false;
+
+  byte        type     = getType();
+  byte        length   = getLength();
+  const byte* payload  = getPayload();
+  byte        sequence = (( type == WGSYNC_DATA) && length) ? payload[ 0] : 0;
+
+  if ( getStatus() != WGSYNC_OK) {
+    _answer( type, sequence, getStatus());                  // host sends frame again
+
+    return true;
+  }
+
+  switch ( type) {
+    case WGSYNC_HELLO:
+      _count = 0;
+
+      if ( length && ( payload[ 0] & WGSYNC_REPLACE)) _db.deleteAll();
+                                                            // one commit
+      _answer( type, 0, WGSYNC_OK);
+      break;
+    case WGSYNC_DATA:
+      if (( length < 1) || (( length - 1) % WGSYNC_RECORD)) {
+        _answer( type, sequence, WGSYNC_BAD_DATA);
+      } else {
+        _db.beginBatch();                                   // one storage commit per frame
+        byte status = _apply( payload + 1, ( length - 1) / WGSYNC_RECORD);
+        _db.commitBatch();
+
+        _answer( type, sequence, status);                   // ACK = records stored
+      }
+      break;
+    case WGSYNC_END:
+      _answer( type, 0, WGSYNC_OK);
+      break;
+    case WGSYNC_EXPORT:
+      exportTags();
+      break;
+    default:
+      _answer( type, 0, WGSYNC_BAD_DATA);
+  }
+
+  return true;
+}
+
+// send all tags (DATA frames of WIEGAND_SYNC_RECORDS records + END with record count)
+void WiegandSync::exportTags()
+{
+  byte          buffer[ WGSYNC_PAYLOAD];
+  byte          records  = 0;
+  byte          sequence = 0;
+  unsigned long count    = 0;
+  int           capacity = _db.getCapacity();
+
+  for ( int slot = 0; slot < capacity; slot++) {            // slot by slot (constant RAM)
+    unsigned long tag = _db.getTagCode( slot);
+
+    if ( tag == 0x00000000) continue;                       // empty slot
+
+    putRecord( buffer + 1 + records * WGSYNC_RECORD, WGSYNC_UPSERT, tag, WG_KEY( _db.getGroup( slot), _db.getKeyCode( slot)));
+    count++;
+
+    if ( ++records == WIEGAND_SYNC_RECORDS) {
+      buffer[ 0] = sequence++;
+      send( WGSYNC_DATA, buffer, 1 + records * WGSYNC_RECORD);
+      records = 0;
+    }
+  }
+
+  if ( records) {
+    buffer[ 0] = sequence;
+    send( WGSYNC_DATA, buffer, 1 + records * WGSYNC_RECORD);
+  }
+
+  for ( byte i = 0; i < 4; i++) buffer[ i] = ( count >> ( 8 * i)) & 0xFF;
+
+  send( WGSYNC_END, buffer, 4);
+}
+
+// returns the records applied since HELLO
+unsigned long WiegandSync::getCount()
+{
+  return _count;
+}
+
+// <internal function:> apply records (returns WGSYNC_OK / WGSYNC_BAD_DATA / WGSYNC_FULL)
+byte WiegandSync::_apply( const byte* records, byte count)
+{
+  for ( byte i = 0; i < count; i++) {
+    uint32_t tag, key;
+    byte     op = getRecord( records + i * WGSYNC_RECORD, tag, key);
+
+    if ( op == WGSYNC_UPSERT) {
+      if ( tag == 0x00000000) return WGSYNC_BAD_DATA;       // tag 0 marks an empty slot
+      if ( !_db.createTag(( unsigned long) tag, ( unsigned long) key)) return WGSYNC_FULL;
+    } else if ( op == WGSYNC_DELETE) {
+      _db.deleteTag(( unsigned long) tag);                  // not found = already deleted
+    } else {
+      return WGSYNC_BAD_DATA;
+    }
+
+    _count++;
+  }
+
+  return WGSYNC_OK;
+}
+
+// <internal function:> send ACK (type, sequence, status, records per frame, capacity)
+void WiegandSync::_answer( byte type, byte sequence, byte status)
+{
+  int  capacity   = _db.getCapacity();
+  byte payload[ 6] = { type, sequence, status, WIEGAND_SYNC_RECORDS, ( byte)( capacity & 0xFF), ( byte)( capacity >> 8) };
+
+  send( WGSYNC_ACK, payload, 6);
+}
@@ -0,0 +1,99 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandSync.h
+// Purpose    : Bulk import / export of the tag database over a Stream (Serial, TCP client, ...) in CRC checked frames
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// frame  = WGSYNC_START, type, length, payload[ length], CRC-16 (lo, hi; CCITT over type, length and payload)
+// record = op ( WGSYNC_UPSERT / WGSYNC_DELETE), tag (4 bytes), key (4 bytes), little endian
+//
+// import : host  HELLO( flags)            device ACK( HELLO, 0, status, records per frame, capacity lo, hi)
+//          host  DATA ( sequence, records) device ACK( DATA, sequence, status, ...) once applied and committed
+//          host  END                       device ACK( END, 0, status, ...)
+// export : host  EXPORT                    device DATA ( sequence, records) ..., END( record count, 4 bytes)
+//
+// the host sends the next frame after the ACK of the previous one (a NAK or no answer = send again);
+// records are idempotent, so a frame applied twice (ACK lost) does no harm
+
+#ifndef _WIEGAND_SYNC_H
+#define _WIEGAND_SYNC_H
+
+#include "WiegandPlatform.h"
+
+#ifndef WIEGAND_SYNC_RECORDS
+#define WIEGAND_SYNC_RECORDS 8                              // max records per DATA frame (frame buffer = 3 + 9 * records bytes)
+#endif
+
+#define WGSYNC_START    0x57                                // first byte of a frame ('W')
+#define WGSYNC_RECORD   9                                   // bytes per record
+#define WGSYNC_PAYLOAD  ( 1 + WIEGAND_SYNC_RECORDS * WGSYNC_RECORD)
+                                                            // max payload (sequence + records)
+
+#define WGSYNC_HELLO    'H'                                 // start import (payload: flags)
+#define WGSYNC_DATA     'D'                                 // records (payload: sequence, records)
+#define WGSYNC_END      'E'                                 // end of import / export (export payload: record count)
+#define WGSYNC_EXPORT   'R'                                 // request export
+#define WGSYNC_ACK      'A'                                 // frame handled (payload: type, sequence, status, records per frame, capacity)
+
+#define WGSYNC_UPSERT   'U'                                 // record: create tag or update its key
+#define WGSYNC_DELETE   'X'                                 // record: delete tag (not found = no error)
+
+#define WGSYNC_REPLACE  0x01                                // HELLO flag: delete all tags before import
+
+#define WGSYNC_OK       0                                   // status: frame applied
+#define WGSYNC_BAD_CRC  1                                   // status: CRC error (send again)
+#define WGSYNC_BAD_DATA 2                                   // status: unknown type / op or bad length
+#define WGSYNC_FULL     3                                   // status: no free slot (records before applied)
+
+class Wiegand_EEPROM;
+
+// framing of both ends (device and host tool)
+class WiegandSyncLink {
+public:
+  WiegandSyncLink( Stream&);
+
+  void        send( byte, const byte*, byte);               // send frame (type, payload, length)
+  bool        receive();                                    // read bytes available (true = frame complete)
+
+  byte        getType();                                    // returns the type of the last frame received
+  byte        getLength();                                  // returns the payload length of the last frame
+  const byte* getPayload();                                 // returns the payload of the last frame
+  byte        getStatus();                                  // returns WGSYNC_BAD_CRC / WGSYNC_BAD_DATA on a rejected frame (WGSYNC_OK = none)
+  unsigned int getErrors();                                 // returns the number of frames rejected
+
+  static uint16_t crc16( uint16_t, byte);                   // CRC-16 CCITT (0x1021, start 0xFFFF) of next byte
+  static void     putRecord( byte*, byte, uint32_t, uint32_t);
+                                                            // encode record (buffer, op, tag, key)
+  static byte     getRecord( const byte*, uint32_t&, uint32_t&);
+                                                            // decode record (returns op)
+
+protected:
+  Stream&      _stream;                                     // transport
+  byte         _frame[ 2 + WGSYNC_PAYLOAD];                 // type, length, payload
+  byte         _index;                                      // bytes received (type .. payload)
+  byte         _state;                                      // receive state (0 = waiting for WGSYNC_START)
+  uint16_t     _crc;                                        // CRC received (lo byte first)
+  byte         _status;                                     // result of last frame rejected
+  unsigned int _errors;                                     // frames rejected
+};
+
+// device side: applies imports to / exports the tag database
+class WiegandSync : public WiegandSyncLink {
+public:
+  WiegandSync( Wiegand_EEPROM&, Stream&);
+
+  bool          handle();                                   // process bytes received (call from loop, true = frame handled)
+  void          exportTags();                               // send all tags (DATA frames + END)
+  unsigned long getCount();                                 // returns the records applied since HELLO
+
+protected:
+  Wiegand_EEPROM& _db;                                      // tag database
+  unsigned long   _count;                                   // records applied since HELLO
+
+  byte _apply( const byte*, byte);                          // apply records (buffer, count), returns status
+  void _answer( byte, byte, byte);                          // send ACK (type, sequence, status)
+};
+
+#endif
@@ -0,0 +1,179 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandTrace.cpp
+// Purpose    : Text trace of raw D0 / D1 edges (written from a capture on the device, read by the host replayer)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+#include "WiegandPlatform.h"
+#include "WiegandTrace.h"
+
+#define TRACE_SPACE  0                                      // reader states: between tokens
+#define TRACE_LINE   1                                      // line read
+#define TRACE_DELTA  2                                      // reading delta (after ':')
+#define TRACE_LOST   3                                      // reading lost count (after '!')
+#define TRACE_SKIP   4                                      // invalid token (up to next space)
+#define TRACE_NOTE   5                                      // comment (up to end of line)
+
+// trace written to stream
+WiegandTraceWriter::WiegandTraceWriter( Stream& stream) : _stream( stream)
+{
+  _time    = 0;
+  _delta   = 0;
+  _started = false;
+}
+
+// append edge (delta written when it differs from the previous delta)
+void WiegandTraceWriter::write( const WiegandEdge& edge)
+{
+  uint32_t delta = edge.time - _time;
+
+  if ( _started && ( delta >= WIEGAND_TRACE_GAP)) end();    // gap = next frame on a new line
+
+  if ( _started) _stream.write( ' ');
+
+  _stream.write( edge.line ? '1' : '0');
+
+  if ( !_started || ( delta != _delta)) {                   // first edge of line = always with delta
+    _stream.write( ':');
+    _number( delta);
+  }
+
+  _time    = edge.time;
+  _delta   = delta;
+  _started = true;
+}
+
+// mark edges lost before next edge (ring overrun, own line = next edge written with delta)
+void WiegandTraceWriter::lost( unsigned long count)
+{
+  if ( count == 0) return;
+
+  end();
+  _stream.write( '!');
+  _number( count);
+  _stream.write( '\n');
+}
+
+// end current line
+void WiegandTraceWriter::end()
+{
+  if ( !_started) return;
+
+  _stream.write( '\n');
+  _started = false;
+}
+
+// <internal function:> write decimal number
+void WiegandTraceWriter::_number( unsigned long value)
+{
+  char digits[ 10];
+  byte count = 0;
+
+  do {
+    digits[ count++] = '0' + value % 10;
+    value /= 10;
+  } while ( value && ( count < sizeof( digits)));
+
+  while ( count) _stream.write( digits[ --count]);
+}
+
+// trace reader (edge times start at 0)
+WiegandTraceReader::WiegandTraceReader()
+{
+  _state  = TRACE_SPACE;
+  _time   = 0;
+  _delta  = 0;
+  _lost   = 0;
+  _errors = 0;
+}
+
+// next char of trace (-1 = end of trace), true = edge complete (returned in edge)
+bool WiegandTraceReader::parse( int c, WiegandEdge& edge)
+{
+  if (( _state == TRACE_NOTE) && ( c >= 0) && ( c != '\n')) return false;
+
+  if (( c < 0) || ( c == ' ') || ( c == '\t') || ( c == '\n') || ( c == '\r')) {
+    bool done = _token( edge);
+
+    _state = TRACE_SPACE;
+    return done;
+  }
+
+  switch ( _state) {
+  case TRACE_SPACE:
+    if (( c == '0') || ( c == '1')) {
+      _line   = c - '0';
+      _state  = TRACE_LINE;
+    } else if ( c == '!') {
+      _value  = 0;
+      _digits = false;
+      _state  = TRACE_LOST;
+    } else if ( c == '#') {
+      _state  = TRACE_NOTE;
+    } else {
+      _errors++;
+      _state = TRACE_SKIP;
+    }
+    break;
+  case TRACE_LINE:
+    if ( c == ':') {
+      _value  = 0;
+      _digits = false;
+      _state  = TRACE_DELTA;
+    } else {
+      _errors++;
+      _state = TRACE_SKIP;
+    }
+    break;
+  case TRACE_DELTA:
+  case TRACE_LOST:
+    if (( c >= '0') && ( c <= '9')) {
+      _value  = _value * 10 + ( c - '0');
+      _digits = true;
+    } else {
+      _errors++;
+      _state = TRACE_SKIP;
+    }
+    break;
+  }
+
+  return false;
+}
+
+// returns number of edges marked lost
+unsigned long WiegandTraceReader::getLost()
+{
+  return _lost;
+}
+
+// returns number of invalid tokens (skipped)
+unsigned long WiegandTraceReader::getErrors()
+{
+  return _errors;
+}
+
+// <internal function:> token complete (true = edge)
+bool WiegandTraceReader::_token( WiegandEdge& edge)
+{
+  if ( _state == TRACE_LOST) {
+    if ( _digits) _lost += _value; else _errors++;
+    return false;
+  }
+
+  if (( _state == TRACE_DELTA) && !_digits) {               // ':' without number
+    _errors++;
+    return false;
+  }
+
+  if (( _state != TRACE_LINE) && ( _state != TRACE_DELTA)) return false;
+
+  if ( _state == TRACE_DELTA) _delta = _value;              // no delta = same as previous edge
+
+  _time     += _delta;
+  edge.time  = _time;
+  edge.line  = _line;
+
+  return true;
+}
@@ -0,0 +1,70 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino
+// Library    : Simple Wiegand Library for Arduino
+// File       : WiegandTrace.h
+// Purpose    : Text trace of raw D0 / D1 edges (written from a capture on the device, read by the host replayer)
+// Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
+
+// trace = text, one frame per line; edge = line ('0' = D0, '1' = D1) followed by ":us" = time since the previous
+// edge, left out when equal to the time before (first edge of a line always has it), separated by spaces;
+// a new line starts with the first edge after a gap of WIEGAND_TRACE_GAP us or more,
+// line "!n" = n edges lost before the next edge (capture ring overrun), '#' = comment up to end of line
+//
+// e.g. "0:1503017 1:2000 1 0 0 1 ... 1" = 26 bit frame (2000 us bit interval) 1.5 s after the previous frame
+
+#ifndef _WIEGAND_TRACE_H
+#define _WIEGAND_TRACE_H
+
+#include "WiegandPlatform.h"
+
+#ifndef WIEGAND_TRACE_GAP
+#define WIEGAND_TRACE_GAP 25000                             // gap starting a new line (us, = WIEGAND_END_MAX)
+#endif
+
+struct WiegandEdge {                                        // falling edge on D0 / D1
+  uint32_t time;                                            // micros() of edge
+  byte     line;                                            // 0 = D0, 1 = D1
+};
+
+// trace writer (keeps last edge between calls, so a capture can be written in parts)
+class WiegandTraceWriter {
+public:
+  WiegandTraceWriter( Stream&);
+
+  void write( const WiegandEdge&);                          // append edge
+  void lost( unsigned long);                                // mark edges lost before next edge (ring overrun)
+  void end();                                               // end current line (trace complete)
+
+protected:
+  Stream&  _stream;                                         // output (Serial, file, ...)
+  uint32_t _time;                                           // time of last edge written
+  uint32_t _delta;                                          // time between last two edges (0 = next delta written)
+  bool     _started;                                        // true = edge written on current line
+
+  void _number( unsigned long);                             // write decimal number
+};
+
+// trace reader (fed char by char, edge times start at 0)
+class WiegandTraceReader {
+public:
+  WiegandTraceReader();
+
+  bool parse( int, WiegandEdge&);                           // next char of trace (-1 = end of trace), true = edge complete
+  unsigned long getLost();                                  // returns number of edges marked lost
+  unsigned long getErrors();                                // returns number of invalid tokens (skipped)
+
+protected:
+  byte          _state;                                     // token being read
+  byte          _line;                                      // line of edge being read
+  uint32_t      _value;                                     // number being read
+  bool          _digits;                                    // true = number has digits
+  uint32_t      _time;                                      // time of last edge
+  uint32_t      _delta;                                     // time between last two edges
+  unsigned long _lost;
+  unsigned long _errors;
+
+  bool _token( WiegandEdge&);                               // token complete (true = edge)
+};
+
+#endif
@@ -6,19 +6,66 @@
 // Purpose    : Storing IDs from a Wiegand compatible device (reader / keypad) in EEPROM
 // Repository : https://github.com/DennisB66/Simple-Wiegand-Library-for-Arduino
 
-#include <Arduino.h>
-#include <EEPROM.h>
+#include "WiegandPlatform.h"
 #include "Wiegand_EEPROM.h"
-#include "SimpleUtils.h"
 
 #define NO_WIEGAND_EEPROM_DEBUG                             // use Wiegand_EEPROM_DEBUG for debug info
 
+#define DELETED_KEY   0xFFFFFFFF                            // key value of a deleted slot (older tables only, tag = 0)
+#define TABLE_START   sizeof( AccessHeader)                 // storage address of slot 0
+#define JOURNAL_START ( TABLE_START + ( unsigned long) _capacity * _size)
+                                                            // storage address of journal entry 0
+#define ENTRY_SIZE    ( ENTRY_HEADER + _size)               // bytes per journal entry
+#define ENTRY_COMMIT  0x8000                                // journal slot flag = last entry of a commit
+#define ENTRY_CLEAR   0x7FFF                                // journal slot value = all slots deleted
+#define ENTRY_NONE    0x7FFE                                // journal slot value = commit point only
+#define MAX_CAPACITY  0x7FFD                                // max slots (journal slot values above are reserved)
+#define CONVERT_VERSION ( WIEGAND_EEPROM_VERSION | 0x80)    // header version while a conversion is written (sequence = slot of backup)
+#define BACKUP_MARK   0xB5                                  // first byte of a complete backup of the converted tags
+#define BACKUP_HEADER 3                                     // bytes of backup in front of the tags (mark + count)
+#define LEGACY_TAGS   10                                    // slots of a table without header (older versions, 32 bit tag + 32 bit key)
+
+static const AccessCode EMPTY_CODE = { 0x00000000, 0 };     // value of an empty slot
+
 // constructor
-Wiegand_EEPROM::Wiegand_EEPROM( int pinD0, int pinD1) : Wiegand( pinD0, pinD1)
+Wiegand_EEPROM::Wiegand_EEPROM( int pinD0, int pinD1, WiegandStorage& storage) : Wiegand( pinD0, pinD1), _storage( storage)
 {
-  _slot = -1;                                               // reset last active slot (no active entry)
+  _slot     = -1;                                           // reset last active slot (no active entry)
+  _capacity = MAX_TAGS;
+  _size     = WIEGAND_EEPROM_RECORD;                        // layout of new tables
+  _batch    = 0;                                            // no batch active
+
+  _rules    = 0;                                            // no access decisions
+  _door     = 0;
+  _access   = WG_NONE;
+  _pinTag   = 0;
+  _pinTime  = 0;
+  _log      = 0;                                            // no log
+
+  #if WIEGAND_EEPROM_CACHE
+  for ( int i = 0; i < WIEGAND_EEPROM_CACHE; i++) {
+    _cache[ i].slot    = -1;                                // cache entry unused
+    _cache[ i].used    = 0;
+    _cache[ i].changed = false;
+  }
+
+  _clock = 0;
+  #endif
 
-  _EEPROM2Tags();                                           // copy EEPROM memory to active memory
+  #if WIEGAND_EEPROM_JOURNAL
+  _cleared     = false;
+  _uncommitted = false;
+  _sequence    = 0;
+  _written     = 0;
+  _committed   = 0;
+  #endif
+
+  #if WIEGAND_EEPROM_BLOOM
+  _bloomReady = false;                                      // built by first search (no pass over the tag table at boot)
+  #endif
+
+  _storage.begin();                                         // prepare storage device
+  _EEPROM2Tags();                                           // open tag table (no full copy when cached)
 }
 
 // checks if a new Wiegand code has been received
@@ -27,6 +74,10 @@ bool Wiegand_EEPROM::available()
     if ( Wiegand::available()) {
       searchTag( _tagCode);                                 // set last active slot if existing in EEPROM
 
+      if ( _rules) _decide();                               // grant / deny (constant time)
+      if ( _log)   _log->add(( getType() == WTAG) ? _tagCode : (( _slot >= 0) ? getTagCode( _slot) : 0), _slot, _access, _door);
+                                                            // staged in RAM (written later by log.handle())
+
       return true;                                          // new Wiegand data available
     }
 
@@ -39,23 +90,58 @@ int Wiegand_EEPROM::getSlot()
   return _slot;                                             // last active slot (-1 = no active entry)
 }
 
-// return tag code from lEEPROM ist
+// return number of slots (0 = no tag table opened)
+int Wiegand_EEPROM::getCapacity()
+{
+  return _capacity;                                         // slots in tag table (0 = damaged header, deleteAll starts a new table)
+}
+
+// decide access by rules (door 0 .. 7 = bit of WiegandRule.doors for this reader, others = WG_WRONG_DOOR)
+void Wiegand_EEPROM::setRules( WiegandRules& rules, byte door)
+{
+  _rules = &rules;
+  _door  = door;
+}
+
+// returns the decision for the last code available (WG_NONE = no rules / no code yet)
+WiegandAccess Wiegand_EEPROM::getAccess()
+{
+  return _access;
+}
+
+// add a record to the log for every code available (tag / PIN, slot, decision, door)
+void Wiegand_EEPROM::setLog( WiegandLog& log)
+{
+  _log = &log;
+}
+
+// return tag code from EEPROM list
 unsigned long Wiegand_EEPROM::getTagCode( int slot)
 {
-  if (( slot >= 0) || ( slot < MAX_TAGS)) {
-    return _tags[slot].tag;                                 // return tag code entry
+  if ( _isUsed( slot)) {
+    return _getSlot( slot).tag;                             // return tag code entry
   } else {
-    return 0x00000000;                                      // failure: outside array boundaries
+    return 0x00000000;                                      // failure: empty slot / outside array boundaries
   }
 }
 
 // return key code from EEPROM list
 unsigned long Wiegand_EEPROM::getKeyCode( int slot)
 {
-  if (( slot >= 0) || ( slot < MAX_TAGS)) {
-    return _tags[slot].key;                                 // return tag code entry
+  if ( _isUsed( slot)) {
+    return WG_KEY_PIN( _getSlot( slot).key);                // return key code entry (without group)
   } else {
-    return 0;                                               // failure: outside array boundaries
+    return 0;                                               // failure: empty slot / outside array boundaries
+  }
+}
+
+// return access group from EEPROM list
+byte Wiegand_EEPROM::getGroup( int slot)
+{
+  if ( _isUsed( slot)) {
+    return WG_KEY_GROUP( _getSlot( slot).key);              // return group of key entry
+  } else {
+    return 0;                                               // failure: empty slot / outside array boundaries
   }
 }
 
@@ -68,24 +154,16 @@ bool Wiegand_EEPROM::searchTag()
 // search for specic tag in EEPROM list (true = found)
 bool Wiegand_EEPROM::searchTag( unsigned long tag)
 {
-  _slot = -1;                                               // not found = no success (yet)
-
-  for ( int i = 0; i < MAX_TAGS; i++) {
-    if ( tag == _tags[ i].tag) {                            // tag found in EEPROM list
-      _slot = i;
-
-      return true;                                          // success
-    }
-  }
+  _slot = _findSlot( tag);                                  // hash lookup (-1 = not found)
 
-  return false;                                             // failure
+  return _slot >= 0;                                        // true = success
 }
 
 // return specic key in active EEPROM slot (true = found)
 bool Wiegand_EEPROM::searchKey()
 {
-  if (( _slot >= 0) || ( _slot < MAX_TAGS)) {
-    return ( _keyCode == _tags[ _slot].key);                // true = key found in EEPROM list
+  if ( _isUsed( _slot)) {
+    return ( _keyCode == WG_KEY_PIN( _getSlot( _slot).key));// true = key found in EEPROM list
   } else {
     return false;                                           // failure: outside array boundaries
   }
@@ -101,33 +179,29 @@ bool Wiegand_EEPROM::createTag()
 }
 
 // create tag / key entry in EEPROM list
-bool Wiegand_EEPROM::createTag( unsigned long tag, unsigned long key)
+bool Wiegand_EEPROM::createTag( unsigned long tag, unsigned long key, byte group)
 {
-  for ( int i = 0; i < MAX_TAGS; i++) {
-    if ( _tags[i].tag == tag) {
-      _tags[i].tag = tag;                                   // update tag entry at empty slot
-      _tags[i].key = key;                                   // update tag entry at empty slot
-      _tags2EEPROM();                                       // update EEPROM
-
-      _slot = i;
+  if ( tag == 0x00000000) return false;                     // failure: tag 0 marks an empty slot
 
-      return true;                                          // tag already existing / key created
-    }
-  }
+  if ( group) key = WG_KEY( group, key);                    // group stored in hi byte of key
 
-  for ( int i = 0; i < MAX_TAGS; i++) {
-    if ( _tags[i].tag == 0x00000000) {                      // empty slot found
-      _tags[i].tag = tag;                                   // create tag entry at empty slot
-      _tags[i].key = key;                                   // create key entry at empty slot
-      _tags2EEPROM();                                       // update EEPROM
+  AccessCode code = { ( uint32_t) tag, ( uint32_t) key };
+  int        slot = _findSlot( tag);                        // tag already existing?
 
-      _slot = i;                                            // set active slot
+  if ( !_fits( code)) return false;                         // failure: tag / PIN / group too large for slot layout
 
-      return true;                                          // tag already existing / key created
-    }
+  if ( slot >= 0) {
+    if ( _getSlot( slot).key != key) _setSlot( slot, code); // update key entry (if changed)
+  } else if ( _insert( code)) {                             // create tag / key entry at first free slot
+    slot = _findSlot( tag);
+  } else {
+    return false;                                           // failure: no empty slot
   }
 
-  return false;                                             // failure: no tag / key creation
+  _slot = slot;                                             // set active slot
+  _commit();                                                // update EEPROM (changed slot only)
+
+  return true;                                              // tag already existing / key created
 }
 
 // delete tag entry for last active code in EEPROM (true = deleted)
@@ -139,14 +213,18 @@ bool Wiegand_EEPROM::deleteTag()
 // delete tag entry for a specific slot in EEPROM (true = deleted)
 bool Wiegand_EEPROM::deleteTag( int slot)
 {
-  if (( slot >= 0) || ( slot < MAX_TAGS)) {
-    _tags[ slot].tag = 0x00000000;                          // clear tag entry at slot = slot
-    _tags[ slot].key = 0;                                   // clear tag entry at slot = slot
-    _tags2EEPROM();                                         // update EEPROM
+  if ( _isUsed( slot)) {
+    _remove( slot);                                         // clear tag entry at slot = slot
+    _commit();                                              // update EEPROM (changed slots only)
+
+    #if WIEGAND_EEPROM_BLOOM
+    _bloomStale++;                                          // bits of tag kept (may be shared)
+    _bloomCheck();
+    #endif
 
     return true;                                            // success = slot wiped
   } else {
-    return false;                                           // failure: outside array boundaries
+    return false;                                           // failure: empty slot / outside array boundaries
   }
 }
 
@@ -160,25 +238,939 @@ bool Wiegand_EEPROM::deleteTag( unsigned long tag)
   }
 }
 
-// delete all tags in EEPROM
+// delete all tags in EEPROM (no table opened = new empty table)
 void Wiegand_EEPROM::deleteAll() {
-  for ( int i = 0; i < MAX_TAGS; i++){
-    deleteTag( i);                                          // delete a spcific tag (slot = i)
+  if ( _capacity == 0) {
+    _size     = WIEGAND_EEPROM_RECORD;                      // table not opened (damaged header) = replaced
+    _capacity = _tableCapacity();
+    _slot     = -1;
+
+    _tags2EEPROM( 0, 0, TABLE_START);                       // empty table + header
+    return;
+  }
+
+  #if WIEGAND_EEPROM_JOURNAL
+  #if WIEGAND_EEPROM_CACHE
+  for ( int i = 0; i < WIEGAND_EEPROM_CACHE; i++) {
+    _cache[ i].slot    = -1;                                // forget cached slots
+    _cache[ i].changed = false;                             // earlier changes are overruled
+  }
+  #else
+  for ( int i = 0; i < MAX_TAGS; i++) {
+    _pack( EMPTY_CODE, _cache[ i].record.data, WIEGAND_EEPROM_RECORD);
+    _setChanged( i, false);                                 // earlier changes are overruled
+  }
+  #endif
+
+  _cleared = true;                                          // single journal entry
+  #else
+  for ( int i = 0; i < _capacity; i++){
+    if ( _isUsed( i)) _setSlot( i, EMPTY_CODE);             // clear used slots only
+  }
+  #endif
+
+  _slot = -1;
+  _commit();                                                // update EEPROM (one commit)
+
+  #if WIEGAND_EEPROM_BLOOM
+  memset( _bloom, 0, sizeof( _bloom));                      // no tags stored
+  _bloomTags  = 0;
+  _bloomStale = 0;
+  _bloomReady = true;
+  #endif
+}
+
+// collect changes (no EEPROM writes until commitBatch)
+void Wiegand_EEPROM::beginBatch()
+{
+  _batch++;                                                 // batches may be nested
+}
+
+// write all changes collected since beginBatch
+void Wiegand_EEPROM::commitBatch()
+{
+  if ( _batch > 0) _batch--;
+
+  _commit();                                                // commit when outer batch completed
+
+  #if WIEGAND_EEPROM_BLOOM
+  _bloomCheck();                                            // deletes of batch
+  #endif
+}
+
+// <internal function> access decision for last code available (tag = rule of its group, PIN = matches tag presented before)
+void Wiegand_EEPROM::_decide()
+{
+  if ( getType() == WTAG) {
+    _pinTag = 0;
+
+    if ( _slot < 0) {
+      _access = WG_UNKNOWN;                                 // tag not stored
+      return;
+    }
+
+    unsigned long key = _getSlot( _slot).key;
+
+    _access = _rules->check( key, _door);                   // door + schedule bit
+
+    if (( _access == WG_GRANTED) && WG_KEY_PIN( key)) {     // tag + PIN
+      _access  = WG_ENTER_PIN;
+      _pinTag  = _tagCode;
+      _pinTime = millis();
+    }
+  } else if ( getType() == WKEY) {
+    if (( _pinTag == 0) || ( millis() - _pinTime > WIEGAND_RULES_PIN_WAIT) || !searchTag( _pinTag)) {
+      _access = WG_UNKNOWN;                                 // PIN without (recent) tag
+    } else {
+      unsigned long key = _getSlot( _slot).key;
+
+      _access = ( WG_KEY_PIN( key) == _keyCode) ? _rules->check( key, _door) : WG_BAD_PIN;
+    }
+
+    _pinTag = 0;                                            // one attempt per tag
+  }
+}
+
+// <internal function> first slot to probe for a tag (multiplicative hash)
+int Wiegand_EEPROM::_hashSlot( unsigned long tag)
+{
+  uint32_t hash = ( uint32_t) tag * 2654435761UL;           // spread sequential tag codes
+
+  if ( _capacity == 0) return 0;                            // no table opened (no slot probed)
+
+  return ( hash >> 16) % _capacity;
+}
+
+// <internal function> slot holding a tag (-1 = not found)
+int Wiegand_EEPROM::_findSlot( unsigned long tag)
+{
+  if ( tag == 0x00000000) return -1;                        // tag 0 marks an empty slot
+
+  #if WIEGAND_EEPROM_BLOOM
+  if ( !_bloomReady) _bloomBuild();                         // first search / too many deletes = one pass over the tag table
+  if ( !_bloomTest( tag)) return -1;                        // not stored (no slot read)
+  #endif
+
+  int slot = _hashSlot( tag);
+
+  for ( int i = 0; i < _capacity; i++) {                    // linear probing
+    unsigned long found = _getSlot( slot).tag;
+
+    if ( found == tag)        return slot;                  // tag found
+    if ( found == 0x00000000) break;                        // empty slot = end of probe chain
+
+    if ( ++slot == _capacity) slot = 0;
+  }
+
+  return -1;                                                // tag not found
+}
+
+// <internal function> true = slot holds a tag entry
+bool Wiegand_EEPROM::_isUsed( int slot)
+{
+  return ( slot >= 0) && ( slot < _capacity) && ( _getSlot( slot).tag != 0x00000000);
+}
+
+// <internal function> insert tag entry at first free slot of its probe chain (false = table full)
+bool Wiegand_EEPROM::_insert( const AccessCode& code)
+{
+  int slot = _hashSlot( code.tag);
+
+  for ( int i = 0; i < _capacity; i++) {                    // linear probing
+    if ( !_isUsed( slot)) {
+      _setSlot( slot, code);
+
+      #if WIEGAND_EEPROM_BLOOM
+      if ( _bloomReady) _bloomAdd( code.tag);               // else added by the build
+      #endif
+
+      return true;
+    }
+
+    if ( ++slot == _capacity) slot = 0;
+  }
+
+  return false;                                             // no empty slot
+}
+
+// <internal function> remove tag entry, moving back entries of its probe chain (no deleted markers needed)
+void Wiegand_EEPROM::_remove( int slot)
+{
+  int hole = slot;                                          // slot to be filled
+  int next = slot;
+
+  for ( int i = 1; i < _capacity; i++) {
+    if ( ++next == _capacity) next = 0;
+    if ( !_isUsed( next)) break;                            // empty slot = end of probe chain
+
+    AccessCode code = _getSlot( next);
+    int        home = _hashSlot( code.tag);                 // entry may stay if home in ( hole, next]
+    bool       stay = ( hole <= next) ? (( hole < home) && ( home <= next)) : (( hole < home) || ( home <= next));
+
+    if ( !stay) {
+      _setSlot( hole, code);                                // move entry back to hole
+      hole = next;
+    }
+  }
+
+  _setSlot( hole, EMPTY_CODE);                              // last hole = empty slot
+}
+
+#if WIEGAND_EEPROM_BLOOM
+#define BLOOM_BITS ( 8UL * WIEGAND_EEPROM_BLOOM)            // bits in filter
+
+// <internal function> add tag to filter (WIEGAND_EEPROM_BLOOM_HASHES bits, double hashing)
+void Wiegand_EEPROM::_bloomAdd( unsigned long tag)
+{
+  uint32_t h1 = ( uint32_t) tag * 2654435761UL;             // as _hashSlot
+  uint32_t h2 = ((( uint32_t) tag ^ ( tag >> 15)) * 0x2C1B3C6DUL) | 1;
+
+  for ( byte i = 0; i < WIEGAND_EEPROM_BLOOM_HASHES; i++, h1 += h2) {
+    uint16_t bit = ( h1 >> 8) % BLOOM_BITS;
+
+    _bloom[ bit >> 3] |= 1 << ( bit & 0x07);
+  }
+
+  _bloomTags++;
+}
+
+// <internal function> false = tag not stored (true = tag possibly stored)
+bool Wiegand_EEPROM::_bloomTest( unsigned long tag)
+{
+  uint32_t h1 = ( uint32_t) tag * 2654435761UL;
+  uint32_t h2 = ((( uint32_t) tag ^ ( tag >> 15)) * 0x2C1B3C6DUL) | 1;
+
+  for ( byte i = 0; i < WIEGAND_EEPROM_BLOOM_HASHES; i++, h1 += h2) {
+    uint16_t bit = ( h1 >> 8) % BLOOM_BITS;
+
+    if ( !( _bloom[ bit >> 3] & ( 1 << ( bit & 0x07)))) return false;
+  }
+
+  return true;
+}
+
+// <internal function> rebuild filter from tag table (reads all slots once)
+void Wiegand_EEPROM::_bloomBuild()
+{
+  memset( _bloom, 0, sizeof( _bloom));
+  _bloomTags  = 0;
+  _bloomStale = 0;
+
+  for ( int i = 0; i < _capacity; i++) {
+    AccessCode code = _peekSlot( i);                        // cache not changed
+
+    if ( code.tag != 0x00000000) _bloomAdd( code.tag);
+  }
+
+  _bloomReady = true;
+}
+
+// <internal function> rebuild filter by next search when more than 1/4 of its tags were deleted (not within a batch)
+void Wiegand_EEPROM::_bloomCheck()
+{
+  if (( _batch == 0) && ( _bloomStale > _bloomTags / 4)) _bloomReady = false;
+}
+#endif
+
+// <internal function> RAM entry of slot (least recently used entry replaced if not cached)
+AccessCache* Wiegand_EEPROM::_entry( int slot)
+{
+  #if WIEGAND_EEPROM_CACHE
+  AccessCache* oldest = &_cache[ 0];
+
+  for ( int i = 0; i < WIEGAND_EEPROM_CACHE; i++) {
+    AccessCache* entry = &_cache[ i];
+
+    if ( entry->slot == slot) {
+      entry->used = ++_clock;                               // slot cached
+      return entry;
+    }
+
+    if (( uint16_t)( _clock - entry->used) > ( uint16_t)( _clock - oldest->used)) oldest = entry;
+  }
+
+  if ( oldest->changed) _flush( oldest);                    // keep change before reuse
+
+  oldest->code    = _loadSlot( slot);                       // read slot from storage
+  oldest->slot    = slot;
+  oldest->used    = ++_clock;
+  oldest->changed = false;
+
+  return oldest;
+  #else
+  return &_cache[ slot];                                    // all slots in RAM
+  #endif
+}
+
+// <internal function> return slot value (via cache)
+AccessCode Wiegand_EEPROM::_getSlot( int slot)
+{
+  #if WIEGAND_EEPROM_CACHE
+  return _entry( slot)->code;
+  #else
+  return _cached( slot);                                    // all slots in RAM (cache entry = slot)
+  #endif
+}
+
+// <internal function> return slot value (cache not changed, used while writing the tag table)
+AccessCode Wiegand_EEPROM::_peekSlot( int slot)
+{
+  #if WIEGAND_EEPROM_CACHE
+  for ( int i = 0; i < WIEGAND_EEPROM_CACHE; i++) {
+    if ( _cache[ i].slot == slot) return _cache[ i].code;   // slot cached
+  }
+
+  return _loadSlot( slot);                                  // read slot from storage
+  #else
+  return _cached( slot);                                    // all slots in RAM
+  #endif
+}
+
+// <internal function> read slot value from storage (latest journal entry or tag table)
+AccessCode Wiegand_EEPROM::_loadSlot( int slot)
+{
+
+  #if WIEGAND_EEPROM_JOURNAL
+  if ( _cleared) return EMPTY_CODE;                         // all slots deleted (not yet committed)
+
+  for ( uint16_t i = _sequence - _written; i > 0; i--) {    // latest journal entry first
+    uint16_t changed = _journal[ i - 1];
+
+    if ( changed == ENTRY_CLEAR) return EMPTY_CODE;         // all slots deleted
+
+    if ( changed == slot) {
+      AccessEntry entry;
+
+      _storage.read( JOURNAL_START + (( uint16_t)( _written + i - 1) % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE, &entry, ENTRY_SIZE);
+      return _unpack( entry.data, _size);
+    }
+  }
+  #endif
+
+  byte data[ 8];
+
+  _storage.read( TABLE_START + ( unsigned long) slot * _size, data, _size);
+
+  return _unpack( data, _size);
+}
+
+// <internal function> slot value of cache entry (RAM copy = packed as stored)
+AccessCode Wiegand_EEPROM::_cached( int i)
+{
+  #if WIEGAND_EEPROM_CACHE
+  return _cache[ i].code;
+  #else
+  return _unpack( _cache[ i].record.data, WIEGAND_EEPROM_RECORD);
+  #endif
+}
+
+// <internal function> change slot (written to storage on commit)
+void Wiegand_EEPROM::_setSlot( int slot, const AccessCode& code)
+{
+  AccessCache* entry = _entry( slot);
+
+  #if WIEGAND_EEPROM_CACHE
+  entry->code    = code;
+  #else
+  _pack( code, entry->record.data, WIEGAND_EEPROM_RECORD);
+  #endif
+  _setChanged( entry - _cache, true);                       // slot to be written
+}
+
+// <internal function> true = cache entry to be written on commit
+bool Wiegand_EEPROM::_isChanged( int i)
+{
+  #if WIEGAND_EEPROM_CACHE
+  return _cache[ i].changed;
+  #else
+  return _dirty[ i >> 3] & ( 1 << ( i & 0x07));             // one bit per slot
+  #endif
+}
+
+// <internal function> mark cache entry (true = to be written on commit)
+void Wiegand_EEPROM::_setChanged( int i, bool changed)
+{
+  #if WIEGAND_EEPROM_CACHE
+  _cache[ i].changed = changed;
+  #else
+  if ( changed) {
+    _dirty[ i >> 3] |=  ( 1 << ( i & 0x07));
+  } else {
+    _dirty[ i >> 3] &= ~( 1 << ( i & 0x07));
+  }
+  #endif
+}
+
+// <internal function> write changed slots to storage (when no batch active)
+void Wiegand_EEPROM::_commit()
+{
+  if ( _batch > 0) return;                                  // wait for commitBatch
+
+  #if WIEGAND_EEPROM_CACHE
+  const int entries = WIEGAND_EEPROM_CACHE;
+  #else
+  const int entries = MAX_TAGS;
+  #endif
+
+  #if WIEGAND_EEPROM_JOURNAL
+  int needed = _cleared ? 1 : 0;                            // journal entries needed
+
+  for ( int i = 0; i < entries; i++) {
+    if ( _isChanged( i)) needed++;
+  }
+
+  if (( needed == 0) && !_uncommitted) return;              // nothing changed
+
+  bool none = ( needed == 0);                               // only a commit point needed
+
+  if ( none) needed = 1;
+
+  if (( uint16_t)( _sequence - _written) + needed > WIEGAND_EEPROM_JOURNAL) _compact();
+                                                            // journal full = committed entries to tag table first
+  if (( uint16_t)( _sequence - _written) + needed > WIEGAND_EEPROM_JOURNAL) {
+    _rewrite();                                             // commit larger than journal = write tag table instead
+  } else {
+    if ( _cleared) _append( ENTRY_CLEAR, EMPTY_CODE, --needed == 0);
+    if ( none)     _append( ENTRY_NONE,  EMPTY_CODE, --needed == 0);
+
+    for ( int i = 0; i < entries; i++) {
+      if ( _isChanged( i)) {
+        #if WIEGAND_EEPROM_CACHE
+        _append( _cache[ i].slot, _cache[ i].code, --needed == 0);
+        #else
+        _append( i, _cached( i), --needed == 0);
+        #endif
+        _setChanged( i, false);
+      }
+    }
+  }
+
+  _cleared     = false;
+  _uncommitted = false;
+  #else
+  for ( int i = 0; i < entries; i++) {
+    if ( _isChanged( i)) {                                  // write changed slots only
+      #if WIEGAND_EEPROM_CACHE
+      _tag2EEPROM( _cache[ i].slot, _cache[ i].code);
+      #else
+      _tag2EEPROM( i, _cached( i));
+      #endif
+      _setChanged( i, false);
+    }
   }
+  #endif
+
+  _storage.commit();
 }
 
-// copy EEPROM memory to active memory
+// open tag table in storage (only header / journal are read when cached)
 void Wiegand_EEPROM::_EEPROM2Tags()
 {
+  AccessHeader header;
+  bool         convert = false;
+  bool         markers = false;
+
+  _storage.get( 0, header);                                 // check for hashed tag table
+
+  if (( header.magic   != WIEGAND_EEPROM_MAGIC) ||
+      (( header.version != WIEGAND_EEPROM_VERSION) && ( header.version != CONVERT_VERSION)) ||
+      (( header.size != 4) && ( header.size != 6) && ( header.size != 8))) {
+    _size = sizeof( AccessCode);                            // 32 bit tag + 32 bit key
+
+    if ( !_convert( 0, LEGACY_TAGS)) _capacity = 0;         // table without header (unhashed) = convert once, tags not fitting = not opened
+  } else if (( header.capacity == 0) || ( header.capacity > MAX_CAPACITY) ||
+             ( TABLE_START + ( unsigned long) header.capacity * header.size + WIEGAND_EEPROM_JOURNAL * ( ENTRY_HEADER + header.size) > _storage.length()) ||
+             (( header.version == CONVERT_VERSION) && ( TABLE_START + ( unsigned long) header.sequence * header.size + BACKUP_HEADER > _storage.length()))) {
+    _capacity = 0;                                          // damaged header / table of larger storage = not opened (storage unchanged)
+  } else {
+    _capacity = header.capacity;                            // slots in tag table
+    _size     = header.size;                                // layout of tag table (may differ from WIEGAND_EEPROM_LAYOUT)
+
+    if ( header.version == CONVERT_VERSION) {
+      _resume( header.sequence);                            // conversion interrupted by a reset = complete it (journal empty)
+    } else {
+      #if WIEGAND_EEPROM_JOURNAL
+      _sequence = _written = _committed = header.sequence;  // journal starts at last tag table write
+      _journal2Tags();                                      // find changes not yet in tag table
+      #endif
+    }
+
+    #if WIEGAND_EEPROM_CACHE
+    convert = ( _capacity <= MAX_TAGS) && ( _capacity < _tableCapacity());
+                                                            // table sized for RAM = enlarge once
+    if (( _size != WIEGAND_EEPROM_RECORD) && !convert) {    // other layout = convert when tags fit in RAM, else keep layout
+      int tags = 0;
+
+      for ( int i = 0; ( i < _capacity) && ( tags <= MAX_TAGS); i++) {
+        if ( _loadSlot( i).tag != 0x00000000) tags++;
+      }
+
+      convert = ( tags <= MAX_TAGS);
+    }
+    #else
+    convert = ( _capacity != _tableCapacity()) || ( _size != WIEGAND_EEPROM_RECORD);
+                                                            // table with other MAX_TAGS / layout = re-hash once
+    #endif
+
+    for ( int i = 0; ( i < _capacity) && ( _capacity <= MAX_TAGS) && !markers; i++) {
+      AccessCode code = _loadSlot( i);                      // latest value of slot
+
+      if (( code.tag == 0x00000000) && ( code.key == DELETED_KEY)) {
+        markers = true;                                     // deleted markers (older table) = re-hash once
+      }
+    }
+
+    #if WIEGAND_EEPROM_CACHE
+    if (( convert || markers) && ( _capacity > 0) && !_convert( TABLE_START, _capacity) && markers) _capacity = 0;
+                                                            // enlarge / other layout skipped when not safe (table kept), markers kept = not opened
+    #else
+    if (( convert || markers) && ( _capacity > 0) && !_convert( TABLE_START, _capacity)) _capacity = 0;
+                                                            // tags not fitting RAM / layout / no room for backup = not opened (storage unchanged)
+    #endif
+  }
+
+  #if !WIEGAND_EEPROM_CACHE
   for ( int i = 0; i < MAX_TAGS; i++) {
-    EEPROM.get( i * sizeof(AccessCode), _tags[i]);          // copy EEPROM to buffer (byte-wise)
+    _pack(( i < _capacity) ? _loadSlot( i) : EMPTY_CODE, _cache[ i].record.data, WIEGAND_EEPROM_RECORD);
+    _setChanged( i, false);                                 // copy EEPROM to buffer
   }
+  #endif
 }
 
-// copy active memory to EEPROM memory
-void Wiegand_EEPROM::_tags2EEPROM()
+// <internal function> convert older / other tag table (storage address, number of slots; false = table not converted,
+// storage unchanged, when a tag would not fit RAM / layout or there is no room for a backup of the tags)
+bool Wiegand_EEPROM::_convert( unsigned long start, int capacity)
 {
-  for ( int i = 0; i < MAX_TAGS; i++) {
-    EEPROM.put( i * sizeof(AccessCode), _tags[i]);          // copy EEPROM to buffer (byte-wise)
+  AccessCode    codes[ MAX_TAGS];                           // tags of old table (more = not converted)
+  int           count = 0;
+  int           tags  = 0;
+  int           slots = _capacity;                          // table kept = restored
+  byte          size  = _size;
+  unsigned long used  = ( start == TABLE_START) ? JOURNAL_START + WIEGAND_EEPROM_JOURNAL * ENTRY_SIZE : start + ( unsigned long) capacity * _size;
+                                                            // end of old table (+ journal), kept until the new table is complete
+  for ( int i = 0; i < capacity; i++) {
+    AccessCode code;
+
+    if ( start == TABLE_START) {
+      code = _loadSlot( i);                                 // table with header (incl. journal entries)
+    } else {
+      byte data[ 8];
+
+      _storage.read( start + ( unsigned long) i * _size, data, _size);
+      code = _unpack( data, _size);
+    }
+
+    if (( code.tag == 0x00000000) || ( code.tag == 0xFFFFFFFF)) continue;
+                                                            // skip empty / erased / deleted entries
+    if ( count == MAX_TAGS) return false;                   // more tags than RAM holds = not converted (never truncated)
+
+    codes[ count++] = code;
+  }
+
+  _size     = WIEGAND_EEPROM_RECORD;                        // new table in layout of WIEGAND_EEPROM_LAYOUT
+  _capacity = _tableCapacity();
+
+  bool complete = true;
+
+  for ( int i = 0; i < count; i++) {                        // skip double entries
+    bool twice = false;
+
+    for ( int j = 0; j < tags; j++) {
+      if ( codes[ j].tag == codes[ i].tag) twice = true;
+    }
+
+    if ( twice) continue;
+
+    if ( _fits( codes[ i]) && ( tags < _capacity)) {
+      codes[ tags++] = codes[ i];
+    } else {
+      complete = false;                                     // value not fitting layout / table full = tag would be lost
+    }
+  }
+
+  if ( complete && _tags2EEPROM( codes, tags, used)) return true;
+                                                            // store converted table
+
+  _capacity = slots;
+  _size     = size;
+
+  return false;
+}
+
+// index of tag placed at slot (-1 = none)
+static int placed( const int* slots, int count, int slot)
+{
+  for ( int i = 0; i < count; i++) {
+    if ( slots[ i] == slot) return i;
+  }
+
+  return -1;
+}
+
+// <internal function> write converted tag table (tags, storage used by old table; false = nothing written, no room for
+// a backup): the tags are backed up behind the old table, the header marks the conversion, all slots are written, the
+// backup is cleared and the header of the new table is written last (reset during conversion = completed by _resume)
+bool Wiegand_EEPROM::_tags2EEPROM( const AccessCode* codes, int count, unsigned long used)
+{
+  int           slots[ MAX_TAGS];                           // slot of each tag in new table
+  int           cells  = ( BACKUP_HEADER + count * sizeof( AccessCode) + _size - 1) / _size;
+  int           first  = ( used > TABLE_START) ? ( used - TABLE_START + _size - 1) / _size : 0;
+  unsigned long end    = JOURNAL_START + WIEGAND_EEPROM_JOURNAL * ENTRY_SIZE;
+  int           backup = ( end - TABLE_START + _size - 1) / _size;
+                                                            // slot of backup (behind old table, new table + journal)
+  for ( int i = 0; i < count; i++) {                        // linear probing (as _insert)
+    int slot = _hashSlot( codes[ i].tag);
+
+    while ( placed( slots, i, slot) >= 0) {
+      if ( ++slot == _capacity) slot = 0;
+    }
+
+    slots[ i] = slot;
+  }
+
+  if ( backup < first) backup = first;
+
+  if ( TABLE_START + ( unsigned long)( backup + cells) * _size > _storage.length()) {
+    backup = first;                                         // no room behind new table = slots empty in new table
+
+    for ( int i = 0; ( i < count) && ( backup + cells <= _capacity); i++) {
+      if (( slots[ i] >= backup) && ( slots[ i] < backup + cells)) {
+        backup = slots[ i] + 1;
+        i      = -1;
+      }
+    }
+
+    if ( backup + cells > _capacity) backup = -1;           // no room = empty table only (nothing lost by a reset)
+  }
+
+  if (( backup < 0) && ( count > 0)) return false;          // tags without backup would be lost by a reset = not converted
+
+  if ( backup >= 0) {
+    AccessHeader  header  = { WIEGAND_EEPROM_MAGIC, CONVERT_VERSION, _size, ( uint16_t) _capacity, ( uint16_t) backup };
+    unsigned long address = TABLE_START + ( unsigned long) backup * _size;
+    uint16_t      tags    = count;
+    byte          mark    = BACKUP_MARK;
+    byte          data[ 8];
+
+    _storage.write( address + 1, &tags, sizeof( tags));
+
+    for ( int i = 0; i < count; i++) {
+      _pack( codes[ i], data, sizeof( AccessCode));         // 32 bit tag + 32 bit key
+      _storage.write( address + BACKUP_HEADER + i * sizeof( AccessCode), data, sizeof( AccessCode));
+    }
+
+    _storage.write( address, &mark, 1);                     // backup complete
+    _storage.put( 0, header);                               // old table given up (conversion resumed from backup)
+    _storage.commit();
+  }
+
+  for ( int i = 0; i < _capacity; i++) {
+    int tag = placed( slots, count, i);
+
+    if (( backup < 0) || ( i < backup) || ( i >= backup + cells)) _tag2EEPROM( i, ( tag >= 0) ? codes[ tag] : EMPTY_CODE);
+  }
+
+  if ( backup >= 0) {
+    _finish( backup);                                       // clear backup + header
+  } else {
+    _header2EEPROM();
+  }
+
+  return true;
+}
+
+// <internal function> complete conversion interrupted by a reset (header = converted table, backup at slot)
+void Wiegand_EEPROM::_resume( int backup)
+{
+  AccessCode    codes[ MAX_TAGS];
+  unsigned long address = TABLE_START + ( unsigned long) backup * _size;
+  uint16_t      tags;
+  byte          mark;
+  byte          data[ 8];
+
+  #if WIEGAND_EEPROM_JOURNAL
+  _sequence = _written = _committed = 0;                    // journal restarts with converted table
+  #endif
+
+  _storage.read( address, &mark, 1);
+  _storage.read( address + 1, &tags, sizeof( tags));
+
+  if ( mark != BACKUP_MARK) {                               // slots written = backup partly cleared
+    _finish( backup);
+    return;
+  }
+
+  if (( tags > MAX_TAGS) || ( address + BACKUP_HEADER + ( unsigned long) tags * sizeof( AccessCode) > _storage.length())) {
+    _capacity = 0;                                          // backup of another build / damaged = not opened (storage unchanged)
+    return;
+  }
+
+  for ( int i = 0; i < tags; i++) {
+    _storage.read( address + BACKUP_HEADER + i * sizeof( AccessCode), data, sizeof( AccessCode));
+    codes[ i] = _unpack( data, sizeof( AccessCode));
+  }
+
+  _tags2EEPROM( codes, tags, address);                      // same slots / backup again
+}
+
+// <internal function> clear backup of a conversion (mark first, first slot last) and write header of converted table
+void Wiegand_EEPROM::_finish( int backup)
+{
+  unsigned long address = TABLE_START + ( unsigned long) backup * _size;
+  uint16_t      tags;
+  byte          mark    = 0;
+
+  _storage.write( address, &mark, 1);                       // slots complete (backup no longer used)
+  _storage.read( address + 1, &tags, sizeof( tags));
+
+  for ( int i = ( BACKUP_HEADER + tags * sizeof( AccessCode) + _size - 1) / _size; i > 0; i--) {
+    if ( backup + i <= _capacity) _tag2EEPROM( backup + i - 1, EMPTY_CODE);
+  }                                                         // backup in table = slots emptied (count in first slot = last)
+
+  _header2EEPROM();
+}
+
+// <internal function> write header of complete tag table (+ empty journal)
+void Wiegand_EEPROM::_header2EEPROM()
+{
+  AccessHeader header = { WIEGAND_EEPROM_MAGIC, WIEGAND_EEPROM_VERSION, _size, ( uint16_t) _capacity, 0 };
+
+  #if WIEGAND_EEPROM_JOURNAL
+  AccessEntry entry;
+
+  entry.sequence = _sequence - 1;                           // mark journal as empty (no entry at sequence)
+  entry.slot     = ENTRY_NONE;
+  _pack( EMPTY_CODE, entry.data, _size);
+
+  _storage.write( JOURNAL_START + ( _sequence % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE, &entry, ENTRY_SIZE);
+
+  header.sequence = _written = _committed = _sequence;      // journal entries so far are part of tag table
+  #endif
+
+  _storage.put( 0, header);                                 // mark as hashed tag table (last = table complete)
+  _storage.commit();
+}
+
+// <internal function> write a single slot to tag table
+void Wiegand_EEPROM::_tag2EEPROM( int slot, const AccessCode& code)
+{
+  byte data[ 8];
+
+  _pack( code, data, _size);
+  _storage.write( TABLE_START + ( unsigned long) slot * _size, data, _size);
+}
+
+// <internal function> slots of a new tag table: fitting in storage (behind header, before journal), RAM copy = up to MAX_TAGS
+int Wiegand_EEPROM::_tableCapacity()
+{
+  unsigned long size = _storage.length();
+  unsigned long used = TABLE_START + WIEGAND_EEPROM_JOURNAL * ( ENTRY_HEADER + WIEGAND_EEPROM_RECORD);
+
+  size = ( size > used) ? ( size - used) / WIEGAND_EEPROM_RECORD : 0;
+
+  #if WIEGAND_EEPROM_CACHE
+  if ( size > MAX_CAPACITY) size = MAX_CAPACITY;
+  #else
+  if ( size > MAX_TAGS)     size = MAX_TAGS;                // table copied to RAM
+  #endif
+
+  return ( size > 0) ? size : 1;
+}
+
+// <internal function> true = value fits in slot layout of tag table
+bool Wiegand_EEPROM::_fits( const AccessCode& code)
+{
+  if ( _size == 6) return ( code.tag <= 0xFFFFFFUL) && ( WG_KEY_PIN( code.key) <= 0xFFFFFUL) && ( WG_KEY_GROUP( code.key) <= 15);
+  if ( _size == 4) return ( code.key == 0);                 // tag only
+
+  return true;
+}
+
+// <internal function> stored bytes of slot value (8 = tag + key, 6 = 24 bit tag + 20 bit PIN + 4 bit group, 4 = tag; lo byte first)
+void Wiegand_EEPROM::_pack( const AccessCode& code, byte* data, byte size)
+{
+  byte     tagBytes = ( size == 6) ? 3 : 4;
+  uint32_t key      = code.key;
+
+  if ( size == 6) key = (( uint32_t) WG_KEY_GROUP( key) << 20) | ( WG_KEY_PIN( key) & 0xFFFFFUL);
+
+  for ( byte i = 0; i < size; i++) {
+    data[ i] = ( i < tagBytes) ? ( code.tag >> ( 8 * i)) : ( key >> ( 8 * ( i - tagBytes)));
+  }
+}
+
+// <internal function> slot value of stored bytes (layout = size)
+AccessCode Wiegand_EEPROM::_unpack( const byte* data, byte size)
+{
+  AccessCode code     = EMPTY_CODE;
+  byte       tagBytes = ( size == 6) ? 3 : 4;
+
+  for ( byte i = 0; i < size; i++) {
+    if ( i < tagBytes) {
+      code.tag |= ( uint32_t) data[ i] << ( 8 * i);
+    } else {
+      code.key |= ( uint32_t) data[ i] << ( 8 * ( i - tagBytes));
+    }
+  }
+
+  if ( size == 6) code.key = WG_KEY( code.key >> 20, code.key & 0xFFFFFUL);
+
+  return code;
+}
+
+#if WIEGAND_EEPROM_CACHE
+
+// <internal function> write changed entry before reuse (part of the next commit)
+void Wiegand_EEPROM::_flush( AccessCache* entry)
+{
+  #if WIEGAND_EEPROM_JOURNAL
+  if (( uint16_t)( _sequence - _written) + ( _cleared ? 2 : 1) > WIEGAND_EEPROM_JOURNAL) _compact();
+                                                            // journal full = committed entries to tag table first
+  if (( uint16_t)( _sequence - _written) + ( _cleared ? 2 : 1) > WIEGAND_EEPROM_JOURNAL) {
+    _rewrite();                                             // batch larger than journal = write tag table (incl. entry)
+    return;
+  }
+
+  if ( _cleared) _append( ENTRY_CLEAR, EMPTY_CODE, false);  // keep order of changes
+
+  _append( entry->slot, entry->code, false);                // committed by next commit point
+  _cleared     = false;
+  _uncommitted = true;
+  #else
+  _tag2EEPROM( entry->slot, entry->code);                   // write (batch no longer atomic)
+  #endif
+
+  entry->changed = false;
+}
+#endif
+
+#if WIEGAND_EEPROM_JOURNAL
+// <internal function> find committed journal entries (changes not yet in tag table)
+void Wiegand_EEPROM::_journal2Tags()
+{
+  AccessEntry entry;
+  uint16_t    end = _written;                               // sequence after last commit point
+
+  for ( uint16_t i = 0; i < WIEGAND_EEPROM_JOURNAL; i++) {  // find last commit point
+    _storage.read( JOURNAL_START + (( uint16_t)( _written + i) % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE, &entry, ENTRY_HEADER);
+
+    if ( entry.sequence != ( uint16_t)( _written + i)) break;
+                                                            // older entry = end of journal
+    if ( entry.slot & ENTRY_COMMIT) end = _written + i + 1;
+  }
+
+  for ( _sequence = _written; _sequence != end; _sequence++) {
+    _storage.read( JOURNAL_START + ( _sequence % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE, &entry, ENTRY_HEADER);
+
+    _journal[ ( uint16_t)( _sequence - _written)] = entry.slot & ~ENTRY_COMMIT;
+                                                            // slot changed by entry
+  }
+
+  _committed = end;
+}
+
+// <internal function> append journal entry (position = sequence, wear spread over all entries); value first, slot
+// next and sequence last, so an entry torn by a reset never carries the current sequence (ignored on replay)
+void Wiegand_EEPROM::_append( uint16_t slot, const AccessCode& code, bool commit)
+{
+  AccessEntry   entry;
+  unsigned long address = JOURNAL_START + ( _sequence % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE;
+
+  entry.sequence = _sequence;
+  entry.slot     = commit ? ( slot | ENTRY_COMMIT) : slot;  // last entry = commit point
+  _pack( code, entry.data, _size);
+
+  _storage.write( address + ENTRY_HEADER, entry.data, _size);
+  _storage.write( address + sizeof( entry.sequence), &entry.slot, sizeof( entry.slot));
+  _storage.write( address, &entry.sequence, sizeof( entry.sequence));
+                                                            // entry valid once sequence is written
+  _journal[ ( uint16_t)( _sequence - _written)] = slot;     // slot changed by entry
+  _sequence++;
+
+  if ( commit) _committed = _sequence;
+}
+
+// <internal function> write committed journal entries to tag table and restart journal at the last commit point; each
+// slot gets its committed value, so a reset before the header is written replays the same entries (nothing lost)
+void Wiegand_EEPROM::_compact()
+{
+  uint16_t count = _committed - _written;                   // committed entries
+  uint16_t clear = 0;                                       // entries up to last ENTRY_CLEAR (0 = none)
+
+  if ( count == 0) return;
+
+  AccessHeader header = { WIEGAND_EEPROM_MAGIC, WIEGAND_EEPROM_VERSION, _size, ( uint16_t) _capacity, _committed };
+
+  for ( uint16_t j = 0; j < count; j++) {
+    if ( _journal[ j] == ENTRY_CLEAR) clear = j + 1;
   }
+
+  for ( int i = 0; i < _capacity; i++) {
+    uint16_t j = count;
+
+    while (( j > clear) && ( _journal[ j - 1] != i)) j--;   // last committed entry of slot
+
+    if ( j > clear) {
+      AccessEntry entry;
+
+      _storage.read( JOURNAL_START + (( uint16_t)( _written + j - 1) % WIEGAND_EEPROM_JOURNAL) * ENTRY_SIZE, &entry, ENTRY_SIZE);
+      _tag2EEPROM( i, _unpack( entry.data, _size));
+    } else if ( clear > 0) {
+      _tag2EEPROM( i, EMPTY_CODE);                          // deleted by ENTRY_CLEAR
+    }
+  }
+
+  _storage.put( 0, header);                                 // committed entries are part of tag table
+
+  for ( uint16_t j = count; j < ( uint16_t)( _sequence - _written); j++) {
+    _journal[ j - count] = _journal[ j];                    // uncommitted entries (evicted in a batch) stay in journal
+  }
+
+  _written = _committed;
+}
+
+// <internal function> write all changes (journal + RAM) to tag table and restart journal (commit larger than the
+// journal = written in place, not atomic)
+void Wiegand_EEPROM::_rewrite()
+{
+  AccessHeader header = { WIEGAND_EEPROM_MAGIC, WIEGAND_EEPROM_VERSION, _size, ( uint16_t) _capacity, _sequence };
+  bool         all    = _cleared;                           // all slots deleted = write all slots
+
+  #if WIEGAND_EEPROM_CACHE
+  const int entries = WIEGAND_EEPROM_CACHE;
+  #else
+  const int entries = MAX_TAGS;
+  #endif
+
+  for ( uint16_t i = 0; i < ( uint16_t)( _sequence - _written); i++) {
+    if ( _journal[ i] == ENTRY_CLEAR) all = true;
+  }
+
+  for ( int i = 0; i < _capacity; i++) {                    // write slots changed by journal
+    bool changed = all;
+
+    for ( uint16_t j = 0; !changed && ( j < ( uint16_t)( _sequence - _written)); j++) {
+      changed = ( _journal[ j] == i);
+    }
+
+    if ( changed) _tag2EEPROM( i, _peekSlot( i));           // latest value of slot
+  }
+
+  for ( int i = 0; i < entries; i++) {                      // write slots changed since last commit
+    if ( _isChanged( i)) {
+      #if WIEGAND_EEPROM_CACHE
+      _tag2EEPROM( _cache[ i].slot, _cache[ i].code);
+      #else
+      _tag2EEPROM( i, _cached( i));
+      #endif
+      _setChanged( i, false);
+    }
+  }
+
+  _storage.put( 0, header);                                 // journal entries so far are part of tag table
+  _written     = _sequence;
+  _committed   = _sequence;
+  _cleared     = false;
+  _uncommitted = false;
 }
+#endif
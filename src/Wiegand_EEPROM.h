@@ -10,49 +10,229 @@
 #define Wiegand_EEPROM_h
 
 #include <Wiegand.h>
+#include "WiegandStorage.h"
+#include "WiegandRules.h"
+#include "WiegandLog.h"
+
+#define WIEGAND_EEPROM_MAGIC   0x5747                       // header magic ("WG") = EEPROM holds a hashed tag table
+#define WIEGAND_EEPROM_VERSION 1                            // header version
+
+#define WG_LAYOUT_WIDE   0                                  // slot layouts: 32 bit tag + 32 bit key (group + PIN), 8 bytes
+#define WG_LAYOUT_PACKED 1                                  // 24 bit tag + 20 bit PIN + 4 bit group, 6 bytes (W26 tags, 6 digit PINs)
+#define WG_LAYOUT_TAG    2                                  // 32 bit tag only, 4 bytes (no PIN / group)
+
+#ifndef WIEGAND_EEPROM_LAYOUT
+#define WIEGAND_EEPROM_LAYOUT WG_LAYOUT_WIDE                // slot layout of new tag tables (stored tables keep their layout unless converted)
+#endif
+
+#if WIEGAND_EEPROM_LAYOUT == WG_LAYOUT_PACKED
+#define WIEGAND_EEPROM_RECORD 6                             // bytes per slot
+#elif WIEGAND_EEPROM_LAYOUT == WG_LAYOUT_TAG
+#define WIEGAND_EEPROM_RECORD 4
+#else
+#define WIEGAND_EEPROM_RECORD 8
+#endif
+
+#if ( WIEGAND_EEPROM_LAYOUT == WG_LAYOUT_PACKED) && ( WIEGAND_RULES_GROUPS > 15)
+#error "WG_LAYOUT_PACKED stores groups 0 .. 15 (lower WIEGAND_RULES_GROUPS)"
+#endif
+
+#ifndef WIEGAND_EEPROM_RAM
+#define WIEGAND_EEPROM_RAM 90                               // RAM for the slots of the tag table copy (bytes + 1 bit per slot, WIEGAND_EEPROM_CACHE = 0)
+#endif
+
+#ifndef MAX_TAGS
+#define MAX_TAGS ( WIEGAND_EEPROM_RAM / WIEGAND_EEPROM_RECORD)
+                                                            // slots in RAM copy (90 bytes: wide = 11, packed = 15, tag = 22), fewer when storage is smaller
+#endif
+
+#ifndef WIEGAND_EEPROM_JOURNAL
+#define WIEGAND_EEPROM_JOURNAL 0                            // journal entries behind the tag table (power of 2, 0 = write tags in place)
+#endif
+
+#ifndef WIEGAND_EEPROM_CACHE
+#define WIEGAND_EEPROM_CACHE 8                              // slots cached in RAM, table sized by storage (0 = complete table of MAX_TAGS in RAM)
+#endif
+
+#ifndef WIEGAND_EEPROM_BLOOM
+#define WIEGAND_EEPROM_BLOOM 0                              // bytes of RAM for a Bloom filter over stored tags (0 = off, e.g. 128 for about 120 tags)
+#endif
+
+#define WIEGAND_EEPROM_BLOOM_HASHES 3                       // filter bits per tag
+
+#if WIEGAND_EEPROM_BLOOM > 8192
+#error "WIEGAND_EEPROM_BLOOM too large (max 8192 bytes)"
+#endif
+
+#ifndef WIEGAND_RULES_PIN_WAIT
+#define WIEGAND_RULES_PIN_WAIT 10000                        // max time between tag and PIN (ms)
+#endif
 
-#define MAX_TAGS 10                                         // max tags (4 bytes per tag) dependent on EEPROM size (512 bytes for Arduino Uno)
 #define NORMAL    0                                         // normal mode = read tags / check authorization in EEPROM database
 #define INSERT    1                                         // insert mode = insert tags to EEPROM database
 #define DELETE    2                                         // delete mode = delete tags in EEPROM database
 
 struct AccessCode {
-  unsigned long tag;                                        // tag value
-  unsigned long key;                                        // key value
+  uint32_t      tag;                                        // tag value
+  uint32_t      key;                                        // key value
+};
+
+struct AccessRecord {                                       // stored slot (fields of layout, lo byte first)
+  byte          data[ WIEGAND_EEPROM_RECORD];
+};
+
+struct AccessHeader {                                       // stored in front of the tag table
+  uint16_t magic;                                           // WIEGAND_EEPROM_MAGIC
+  byte     version;                                         // WIEGAND_EEPROM_VERSION
+  byte     size;                                            // size of one slot (bytes, = layout)
+  uint16_t capacity;                                        // number of slots in the tag table
+  uint16_t sequence;                                        // first journal entry not yet written to the tag table
+};
+
+struct AccessEntry {                                        // journal entry (appended, written to tag table when journal full)
+  uint16_t   sequence;                                      // sequence number (entry position = sequence % WIEGAND_EEPROM_JOURNAL)
+  uint16_t   slot;                                          // slot changed (hi bit = last entry of a commit)
+  byte       data[ 8];                                      // new value of slot (size of slot layout)
+};
+
+#define ENTRY_HEADER 4                                      // bytes of journal entry in front of slot value
+
+struct AccessCache {                                        // slot kept in RAM
+  #if WIEGAND_EEPROM_CACHE
+  AccessCode   code;                                        // tag / key value of slot
+  bool         changed;                                     // true = to be written on commit
+  int          slot;                                        // slot cached (-1 = unused)
+  uint16_t     used;                                        // time of last use (least recently used = replaced)
+  #else
+  AccessRecord record;                                      // slot value (packed as stored, changes in Wiegand_EEPROM::_dirty)
+  #endif
 };
 
 class Wiegand_EEPROM : public Wiegand
 {
   public:
-    Wiegand_EEPROM(int = PIN_D0_DEFAULT, int = PIN_D1_DEFAULT);
-                                                            // constructor
+    Wiegand_EEPROM(int = PIN_D0_DEFAULT, int = PIN_D1_DEFAULT, WiegandStorage& = WiegandEEPROM);
+                                                            // constructor (storage = on-board EEPROM by default)
     bool available();                                       // checks if a new Wiegand code has been received
 
     int  getSlot();                                         // return current slot (in EEPROM list)
+    int  getCapacity();                                     // return number of slots (in EEPROM list, 0 = table not opened)
 
     using Wiegand::getTagCode;                              // return cuurent tag code
     using Wiegand::getKeyCode;                              // return current key code
     unsigned long  getTagCode( int);                        // return tag code from EEPROM list (indicated by slot)
     unsigned long  getKeyCode( int);                        // return key code from EEPROM list (indicated by slot)
+    byte           getGroup( int);                          // return access group from EEPROM list (indicated by slot)
 
     bool searchTag();                                       // search current tag in EEPROM list (true = found)
     bool searchTag( unsigned long);                         // search a given tag in EEPROM list (true = found)
     bool searchKey();
 
     bool createTag();                                       // create tag entry for current code in EEPROM (true = created)
-    bool createTag( unsigned long, unsigned long = 0);      // create tag entry for a given code in EEPROM (true = created)
+    bool createTag( unsigned long, unsigned long = 0, byte = 0);
+                                                            // create tag entry for a given code in EEPROM (tag, PIN, group, true = created)
 
     bool deleteTag();                                       // delete tag entry for last active code in EEPROM (true = deleted)
     bool deleteTag( int);                                   // delete tag entry for a specific slot in EEPROM (true = deleted)
     bool deleteTag( unsigned long);                         // delete tag entry for a specific code in EEPROM (true = deleted)
     void deleteAll();                                       // delete all tag entries in EEPROM
 
+    void beginBatch();                                      // collect changes (no EEPROM writes until commitBatch)
+    void commitBatch();                                     // write all changes collected since beginBatch
+
+    void          setRules( WiegandRules&, byte = 0);       // decide access by rules (rules, door of this reader)
+    WiegandAccess getAccess();                              // returns the decision for the last code available (with rules)
+
+    void          setLog( WiegandLog&);                     // add a record to the log for every code available
+
   protected:
-    int         _slot;                                      // current slot (-1 = not found)
-    AccessCode  _tags[ MAX_TAGS];                           // tags in EEPROM
+    WiegandStorage& _storage;                               // storage device holding the tag table
+    int             _capacity;                              // number of slots in tag table
+    byte            _size;                                  // bytes per slot of stored tag table (layout)
+    int             _slot;                                  // current slot (-1 = not found)
+    byte            _batch;                                 // nesting level of beginBatch / commitBatch
+
+    WiegandRules*   _rules;                                 // access rules (0 = no decisions)
+    byte            _door;                                  // door of this reader (bit of WiegandRule.doors)
+    WiegandAccess   _access;                                // decision for last code available
+    unsigned long   _pinTag;                                // tag waiting for its PIN (0 = none)
+    unsigned long   _pinTime;                               // time tag was presented (ms)
+    WiegandLog*     _log;                                   // access event log (0 = none)
+
+    #if WIEGAND_EEPROM_CACHE
+    AccessCache     _cache[ WIEGAND_EEPROM_CACHE];          // recently used slots
+    uint16_t        _clock;                                 // use counter (for least recently used)
+    #else
+    AccessCache     _cache[ MAX_TAGS];                      // all slots (cache entry = slot)
+    byte            _dirty[ ( MAX_TAGS + 7) / 8];           // bit set = slot to be written on commit
+    #endif
+
+    #if WIEGAND_EEPROM_BLOOM
+    byte            _bloom[ WIEGAND_EEPROM_BLOOM];          // tags possibly stored (bit clear = tag not stored, no storage access)
+    uint16_t        _bloomTags;                             // tags added since last rebuild
+    uint16_t        _bloomStale;                            // tags deleted since last rebuild (bits kept = false positives only)
+    bool            _bloomReady;                            // filter built (false = built by next search)
+    #endif
+
+    #if WIEGAND_EEPROM_JOURNAL
+    uint16_t        _journal[ WIEGAND_EEPROM_JOURNAL];      // slots changed by journal entries not in tag table
+    bool            _cleared;                               // all slots deleted since last commit
+    bool            _uncommitted;                           // journal entries written since last commit
+    uint16_t        _sequence;                              // sequence of next journal entry
+    uint16_t        _written;                               // sequence of first journal entry not in tag table
+    uint16_t        _committed;                             // sequence behind last commit point
+    #endif
+
+    void _decide();                                         // access decision for last code available
+
+    int  _hashSlot( unsigned long);                         // first slot to probe for a tag
+    int  _findSlot( unsigned long);                         // slot holding a tag (-1 = not found)
+    bool _isUsed( int);                                     // true = slot holds a tag entry
+    bool _insert( const AccessCode&);                       // insert tag entry at first free slot of its probe chain
+    void _remove( int);                                     // remove tag entry (shifts back its probe chain)
+
+    AccessCache* _entry( int);                              // RAM entry of slot (loaded if not cached)
+    AccessCode   _getSlot( int);                            // return slot value (via cache)
+    AccessCode   _peekSlot( int);                           // return slot value (cache not changed)
+    AccessCode   _loadSlot( int);                           // read slot value from storage
+    AccessCode   _cached( int);                             // slot value of cache entry
+    void         _setSlot( int, const AccessCode&);         // change slot (written on commit)
+    bool         _isChanged( int);                          // true = cache entry to be written on commit
+    void         _setChanged( int, bool);                   // mark cache entry (true = to be written on commit)
+    void         _commit();                                 // write changed slots to storage
+
+    void _EEPROM2Tags();                                    // open tag table in storage (converted if needed)
+    bool _convert( unsigned long, int);                     // convert older / other tag table (address, capacity)
+    bool _tags2EEPROM( const AccessCode*, int, unsigned long);
+                                                            // write converted tag table (tags, count, storage used by old table; false = no room for backup)
+    void _resume( int);                                     // complete conversion interrupted by a reset (slot of backup)
+    void _finish( int);                                     // clear backup of conversion + write header (slot of backup)
+    void _header2EEPROM();                                  // write header of complete tag table (+ empty journal)
+    void _tag2EEPROM( int, const AccessCode&);              // write a single slot to tag table
+    int  _tableCapacity();                                  // slots of a new tag table (fitting in storage / RAM)
+    bool _fits( const AccessCode&);                         // true = value fits in slot layout of tag table
+
+    static void       _pack( const AccessCode&, byte*, byte);
+                                                            // stored bytes of slot value (layout = size)
+    static AccessCode _unpack( const byte*, byte);          // slot value of stored bytes (layout = size)
+
+    #if WIEGAND_EEPROM_CACHE
+    void _flush( AccessCache*);                             // write changed entry before reuse
+    #endif
+
+    #if WIEGAND_EEPROM_BLOOM
+    void _bloomAdd( unsigned long);                         // add tag to filter
+    bool _bloomTest( unsigned long);                        // false = tag not stored
+    void _bloomBuild();                                     // rebuild filter from tag table (stale bits removed)
+    void _bloomCheck();                                     // rebuild filter by next search when too many tags were deleted
+    #endif
 
-    void _EEPROM2Tags();                                    // copy EEPROM memory to active memory
-    void _tags2EEPROM();                                    // copy active memory to EEPROM memory
+    #if WIEGAND_EEPROM_JOURNAL
+    void _journal2Tags();                                   // find committed journal entries (not yet in tag table)
+    void _append( uint16_t, const AccessCode&, bool);       // append journal entry (slot, value, commit)
+    void _compact();                                        // write committed journal entries to tag table (journal kept until header)
+    void _rewrite();                                        // write all changes to tag table and restart journal (commit larger than journal)
+    #endif
 };
 
 #endif